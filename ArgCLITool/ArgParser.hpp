@@ -1,19 +1,41 @@
 #pragma once
 
+#include "CLILexer.hpp"
+#include "ResponseFile.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
 #include <cctype>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <charconv>
+#include <functional>
+#include <optional>
+#include <regex>
+#include <span>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
 #include <memory>
+#include <mutex>
 #include <type_traits>
 #include <stdexcept>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
 /*
 TODO:
-- Required flag for arguments
 - Check number of default values matches [min_nvalues, max_nvalues]
-- Help message generation (program_name --help)
 - Usage message generation (program_name help <command>)
 - Custom help message format
 - Type conversion cache for ParsedArgument (use std::type_index as key)
@@ -21,10 +43,614 @@ TODO:
 
 namespace ArgCLITool {
 
+class Args;
+
+// Thrown by parse() when the help option is given, what() is the help message
+class HelpRequested : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+namespace detail {
+
+// Transparent hash, allows std::string keyed maps to be searched with std::string_view
+struct StringHash {
+    using is_transparent = void;
+    inline size_t operator()(std::string_view str) const { return std::hash<std::string_view>{}(str); }
+};
+
+static inline constexpr bool isAlpha(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
+static inline constexpr bool isPositional(std::string_view name) { return name.size() >= 1 && name[0] != '-'; }
+static inline constexpr bool isShortName(std::string_view name) { return name.size() >= 2 && name[0] == '-' && name[1] != '-' && isAlpha(name[1]); }
+static inline constexpr bool isLongName(std::string_view name) { return name.size() >= 3 && name[0] == '-' && name[1] == '-' && isAlpha(name[2]); }
+
+enum class ArgKind { Value, ShortName, LongName };
+
+// Same as isShortName and isLongName in a single pass
+static inline constexpr ArgKind classifyArg(std::string_view arg) {
+    if (arg.size() < 2 || arg[0] != '-') {
+        return ArgKind::Value;
+    }
+    if (arg[1] != '-') {
+        return isAlpha(arg[1]) ? ArgKind::ShortName : ArgKind::Value;
+    }
+    return arg.size() >= 3 && isAlpha(arg[2]) ? ArgKind::LongName : ArgKind::Value;
+}
+
+// Bump allocator for trivially destructible objects, the memory is released all at once on destruction
+class Arena {
+public:
+    template <typename T>
+    T* allocate(size_t n) {
+        static_assert(std::is_trivially_destructible_v<T>);
+        size_t bytes = n * sizeof(T);
+        size_t offset = (used_ + alignof(T) - 1) & ~(alignof(T) - 1);
+        if (blocks_.empty() || offset + bytes > capacity_) {
+            capacity_ = std::max(kBlockSize, bytes);
+            blocks_.emplace_back(new std::byte[capacity_]);
+            offset = 0;
+        }
+        used_ = offset + bytes;
+        return reinterpret_cast<T*>(blocks_.back().get() + offset);
+    }
+
+    std::string_view copy(std::string_view str) {
+        char* data = allocate<char>(str.size());
+        std::copy(str.begin(), str.end(), data);
+        return std::string_view(data, str.size());
+    }
+
+    // keep resource alive until the arena is destroyed, for memory viewed but not owned by the arena
+    void retain(std::shared_ptr<const void> resource) {
+        resources_.push_back(std::move(resource));
+    }
+
+private:
+    static constexpr size_t kBlockSize = 64 * 1024;
+
+    std::vector<std::unique_ptr<std::byte[]>> blocks_;
+    std::vector<std::shared_ptr<const void>> resources_;
+    size_t capacity_ = 0; // capacity of the last block
+    size_t used_ = 0;     // used bytes of the last block
+};
+
+/**
+ * @brief Validate and normalize the number of values of an argument, see ArgParser::ArgumentSetter::nvalues.
+ */
+static inline constexpr void normalizeNValues(bool positional, int& min, int& max) {
+    // check min and max
+    if (min < -1 || max < -1 || (max != -1 && max < min)) {
+        throw std::invalid_argument("Invalid number of values: " + std::to_string(min) + ", " + std::to_string(max));
+    }
+    // check special behavior for positional arguments
+    if (positional && min == 0) {
+        if (max == 0) {
+            throw std::invalid_argument("Positional argument cannot have exactly 0 values");
+        }
+        if (max == -1) {
+            max = 1;
+        }
+    }
+    // check variadic argument (TODO: Add this to the note)
+    if (min == -1 && max != -1) {
+        throw std::invalid_argument("Variadic argument cannot have a maximum number of values");
+    }
+    max = max == -1 ? min : max;
+}
+
+template <typename T>
+struct IsVector : std::false_type {};
+
+template <typename T>
+struct IsVector<std::vector<T>> : std::true_type {};
+
+// Integral and floating point types converted with std::from_chars, bool and characters are read by streams
+template <typename T>
+struct IsNumber : std::bool_constant<(std::is_integral_v<T> || std::is_floating_point_v<T>) && !std::is_same_v<T, bool> &&
+                                     !std::is_same_v<T, char> && !std::is_same_v<T, signed char> &&
+                                     !std::is_same_v<T, unsigned char> && !std::is_same_v<T, wchar_t> &&
+                                     !std::is_same_v<T, char8_t> && !std::is_same_v<T, char16_t> &&
+                                     !std::is_same_v<T, char32_t>> {};
+
+// Floating point value of a number already validated by std::from_chars
+template <typename T>
+inline T parseFloat(const std::string& digits) {
+    if constexpr (std::is_same_v<T, float>) {
+        return std::strtof(digits.c_str(), nullptr);
+    } else if constexpr (std::is_same_v<T, double>) {
+        return std::strtod(digits.c_str(), nullptr);
+    } else {
+        return std::strtold(digits.c_str(), nullptr);
+    }
+}
+
+// Convert a value of the argument named name to T
+template <typename T>
+inline T convertValue(std::string_view value, std::string_view name) {
+    if constexpr (std::is_same_v<T, std::string>) {
+        return std::string(value);
+    } else if constexpr (std::is_same_v<T, std::string_view>) {
+        return value;
+    } else if constexpr (IsNumber<T>::value) { // without the stream, conversion is often done per value in a loop
+        // accepts what the stream accepts: leading whitespace, a '+' sign, negative values wrapped for unsigned
+        // types, floats that underflow, and no infinity or NaN
+        std::string_view digits = value.substr(std::min(value.find_first_not_of(" \t\n\v\f\r"), value.size()));
+        bool negative = std::is_unsigned_v<T> && digits.starts_with('-');
+        bool sign_removed = digits.starts_with('+') || negative;
+        if (sign_removed) {
+            digits.remove_prefix(1);
+        }
+        T converted{};
+        auto [end, error] = std::from_chars(digits.data(), digits.data() + digits.size(), converted);
+        if constexpr (std::is_floating_point_v<T>) {
+            if (error == std::errc::result_out_of_range && end == digits.data() + digits.size()) {
+                converted = parseFloat<T>(std::string(digits)); // zero or subnormal on underflow, infinity on overflow
+                error = std::errc();
+            }
+            if (!std::isfinite(converted)) {
+                error = std::errc::invalid_argument;
+            }
+        }
+        if (error != std::errc() || end != digits.data() + digits.size() || digits.empty() ||
+            (sign_removed && digits.starts_with('-'))) {
+            throw std::invalid_argument("Invalid value '" + std::string(value) + "' for argument: " + std::string(name));
+        }
+        return negative ? static_cast<T>(T(0) - converted) : converted;
+    } else {
+        T converted;
+        std::istringstream iss{std::string(value)};
+        iss >> converted;
+        if (iss.fail() || !iss.eof()) {
+            throw std::invalid_argument("Invalid value '" + std::string(value) + "' for argument: " + std::string(name));
+        }
+        return converted;
+    }
+}
+
+/**
+ * @brief Values of an argument converted to T on access, nothing is copied or converted in advance.
+ *
+ * @note Views the values stored in Args, valid while the Args is alive.
+ */
+template <typename T>
+class ValueView {
+public:
+    class iterator {
+    public:
+        using iterator_concept = std::forward_iterator_tag;
+        using iterator_category = std::input_iterator_tag; // dereferencing returns a converted value, not a reference
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using reference = T;
+
+    public:
+        iterator() = default;
+        iterator(const std::string_view* value, std::string_view name) : value_(value), name_(name) {}
+
+        inline T operator*() const { return convertValue<T>(*value_, name_); }
+        inline iterator& operator++() {
+            ++value_;
+            return *this;
+        }
+        inline iterator operator++(int) {
+            iterator it = *this;
+            ++value_;
+            return it;
+        }
+        inline bool operator==(const iterator& other) const { return value_ == other.value_; }
+
+    private:
+        const std::string_view* value_ = nullptr;
+        std::string_view name_;
+    };
+
+public:
+    ValueView(std::span<const std::string_view> values, std::string_view name) : values_(values), name_(name) {}
+
+    inline iterator begin() const { return iterator(values_.data(), name_); }
+    inline iterator end() const { return iterator(values_.data() + values_.size(), name_); }
+    inline size_t size() const { return values_.size(); }
+    inline bool empty() const { return values_.empty(); }
+
+    inline T operator[](size_t index) const {
+        if (index >= values_.size()) {
+            throw std::out_of_range("Index " + std::to_string(index) + " out of range for argument: " + std::string(name_));
+        }
+        return convertValue<T>(values_[index], name_);
+    }
+
+private:
+    std::span<const std::string_view> values_;
+    std::string_view name_;
+};
+
+// FNV-1a
+static inline constexpr uint64_t hashName(std::string_view name) {
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : name) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// Runtime behavior attached to an argument, not available in compile-time specifications
+struct ArgHooks {
+    std::function<void(std::span<const std::string_view>)> bind; // stores values into a user variable instead of Args
+    std::function<void(std::string_view)> on_value; // receives each value while scanning, values are not collected
+    std::string env;        // environment variable read when the argument is not given, empty if none
+    std::string config_key; // config file key used when the argument is not given, empty if none
+    // value constraints, compiled into a ValueCheck
+    std::vector<std::string> choices;
+    std::optional<std::pair<double, double>> range;
+    std::shared_ptr<const std::regex> pattern;
+    std::string pattern_source;
+};
+
+// Set of strings with a collision-free hash, membership is one hash and one comparison
+class ChoiceSet {
+public:
+    ChoiceSet() = default;
+
+    explicit ChoiceSet(std::span<const std::string> choices) {
+        for (const auto& choice : choices) {
+            if (std::find(choices_.begin(), choices_.end(), choice) == choices_.end()) {
+                choices_.push_back(choice);
+            }
+        }
+        std::vector<uint64_t> hashes;
+        for (std::string_view choice : choices_) {
+            hashes.push_back(hashName(choice));
+        }
+        // search a seed without collisions, the table grows if none is found
+        for (size_t size = std::bit_ceil(std::max<size_t>(2 * choices_.size(), 2)); ; size *= 2) {
+            shift_ = 64 - std::countr_zero(size);
+            for (seed_ = 1; seed_ <= kMaxSeeds; ++seed_) {
+                slots_.assign(size, -1);
+                bool collision = false;
+                for (size_t i = 0; i < hashes.size() && !collision; ++i) {
+                    int& slot = slots_[slotOf(hashes[i])];
+                    collision = slot != -1;
+                    slot = static_cast<int>(i);
+                }
+                if (!collision) {
+                    return;
+                }
+            }
+        }
+    }
+
+    inline bool empty() const { return choices_.empty(); }
+
+    inline bool contains(std::string_view value) const {
+        if (choices_.empty()) {
+            return false;
+        }
+        int index = slots_[slotOf(hashName(value))];
+        return index != -1 && choices_[index] == value;
+    }
+
+    // choices in declaration order
+    inline std::span<const std::string_view> list() const { return choices_; }
+
+private:
+    static constexpr uint64_t kMaxSeeds = 64; // seeds tried per table size
+
+    inline size_t slotOf(uint64_t hash) const {
+        return static_cast<size_t>(((hash ^ seed_) * 0x9E3779B97F4A7C15ull) >> shift_);
+    }
+
+private:
+    std::vector<std::string_view> choices_; // views the strings of the argument
+    std::vector<int> slots_;                // index into choices_, -1 if empty
+    uint64_t seed_ = 0;
+    int shift_ = 63;
+};
+
+// Constraints on each value of an argument, checked once when the argument is parsed
+struct ValueCheck {
+    ChoiceSet choices;
+    std::optional<std::pair<double, double>> range;
+    const std::regex* pattern = nullptr;
+    std::string_view pattern_source;
+
+    void check(std::string_view value, std::string_view name) const {
+        if (!choices.empty() && !choices.contains(value)) {
+            std::string list;
+            for (std::string_view choice : choices.list()) {
+                list += (list.empty() ? "" : ", ") + std::string(choice);
+            }
+            throw std::invalid_argument("Invalid choice '" + std::string(value) + "' for argument: " + std::string(name) +
+                                        " (choose from " + list + ")");
+        }
+        if (range) {
+            double number = convertValue<double>(value, name);
+            if (number < range->first || number > range->second) {
+                std::ostringstream bounds;
+                bounds << "[" << range->first << ", " << range->second << "]";
+                throw std::invalid_argument("Value " + std::string(value) + " out of range " + bounds.str() +
+                                            " for argument: " + std::string(name));
+            }
+        }
+        if (pattern && !std::regex_match(value.begin(), value.end(), *pattern)) {
+            throw std::invalid_argument("Value '" + std::string(value) + "' does not match pattern '" +
+                                        std::string(pattern_source) + "' for argument: " + std::string(name));
+        }
+    }
+};
+
+// Argument flattened for the argv scanner, the strings are owned by the parser that built it
+struct ArgEntry {
+    std::string_view position_name;
+    std::string_view short_name;
+    std::string_view long_name;
+    std::string_view description;
+    std::string_view usage;
+    int min_nvalues = 0;
+    int max_nvalues = 0;
+    std::span<const std::string_view> default_values;
+    bool default_parsed = false;     // considered parsed when not given even without default values (flag enabled by a config file)
+    bool configured = false;         // a config file enables the flag or supplies the default values, counts as given
+    const ArgHooks* hooks = nullptr;
+    const ValueCheck* check = nullptr; // null if the values are not constrained or come from a compile-time specification
+};
+
+// Name of the argument used in messages
+static inline constexpr std::string_view displayName(const ArgEntry& arg) {
+    return !arg.position_name.empty() ? arg.position_name : !arg.short_name.empty() ? arg.short_name : arg.long_name;
+}
+
+// Check the number of values taken from a fallback source (environment variable, config file)
+static inline void checkNValues(const ArgEntry& arg, size_t nvalues, std::string_view source) {
+    bool too_few = static_cast<int>(nvalues) < arg.min_nvalues;
+    bool too_many = arg.min_nvalues != -1 && static_cast<int>(nvalues) > arg.max_nvalues;
+    if (too_few || too_many) {
+        throw std::invalid_argument("Invalid number of values in " + std::string(source) + " for argument: " + std::string(displayName(arg)));
+    }
+}
+
+// Slot of the open addressing table mapping option names to ArgEntry indices
+struct NameSlot {
+    std::string_view name;
+    int index = -1; // -1 for empty slot
+};
+
+// Number of slots for the given number of names, keeps the load factor below 0.5
+static inline constexpr size_t nameTableSize(size_t nnames) { return std::bit_ceil(nnames * 2 + 1); }
+
+// Insert name into the table, returns false if name already exists
+static inline constexpr bool insertName(std::span<NameSlot> slots, std::string_view name, int index) {
+    size_t mask = slots.size() - 1;
+    for (size_t i = hashName(name) & mask; ; i = (i + 1) & mask) {
+        if (slots[i].index == -1) {
+            slots[i] = NameSlot{name, index};
+            return true;
+        }
+        if (slots[i].name == name) {
+            return false;
+        }
+    }
+}
+
+class ArgInput;
+class HelpCache;
+
+/**
+ * @brief Subcommand dispatch of a table.
+ *
+ * Given the first positional argument, parses the rest of the input with the sub-parser of that name into the
+ * command arguments of Args. Returns false if the name is not a subcommand.
+ */
+using CommandDispatch = std::function<bool(std::string_view prog, std::string_view name, ArgInput& input, Args& args)>;
+
+struct CommandInfo {
+    std::string_view name;
+    std::string_view description;
+};
+
+// Fill out with the long names of entries sorted by name, for abbreviation lookup. Returns the number of names.
+static inline constexpr size_t sortLongNames(std::span<const ArgEntry> entries, std::span<NameSlot> out) {
+    size_t count = 0;
+    for (size_t index = 0; index < entries.size(); ++index) {
+        if (!entries[index].long_name.empty()) {
+            out[count++] = NameSlot{entries[index].long_name, static_cast<int>(index)};
+        }
+    }
+    std::sort(out.begin(), out.begin() + count, [](const NameSlot& a, const NameSlot& b) { return a.name < b.name; });
+    return count;
+}
+
+// Bitsets over entry indices, 64 entries per word
+static inline constexpr size_t bitsetWords(size_t nbits) { return (nbits + 63) / 64; }
+static inline constexpr void setBit(std::span<uint64_t> bits, size_t i) { bits[i / 64] |= uint64_t(1) << (i % 64); }
+static inline constexpr bool testBit(std::span<const uint64_t> bits, size_t i) { return (bits[i / 64] >> (i % 64)) & 1; }
+
+// Relations between arguments, as bitsets of bitsetWords(entries.size()) words over entry indices
+struct ArgConstraints {
+    std::span<const uint64_t> required;     // must be provided (command line, environment or config file), empty if none
+    std::span<const uint64_t> exclusive;    // one bitset per group, at most one argument of a group on the command line
+    std::span<const int> dependents;        // entries that require other entries
+    std::span<const uint64_t> dependencies; // one bitset per dependent, entries it requires when provided
+};
+
+// Non-owning view of a compiled argument table
+struct ArgTable {
+    std::span<const ArgEntry> entries;
+    std::span<const NameSlot> slots;     // size must be a power of two
+    std::span<const NameSlot> long_names; // long option names in sorted order, see sortLongNames
+    std::span<const int> positionals;    // indices of positional entries, in declaration order
+    const CommandDispatch* commands = nullptr; // null if the parser has no subcommands
+    std::span<const CommandInfo> command_list; // subcommands in registration order, for the help message
+    // program info, for the help message
+    std::string_view prog;
+    std::string_view usage;
+    std::string_view description;
+    std::string_view epilog;
+    int help_index = -1; // index of the help option entry, -1 if none
+    const HelpCache* help_cache = nullptr; // help message of the table, null to use sharedHelpCache
+    ArgConstraints constraints;
+
+    // index of the entry named name, -1 if not found
+    constexpr int find(std::string_view name) const {
+        size_t mask = slots.size() - 1;
+        for (size_t i = hashName(name) & mask; ; i = (i + 1) & mask) {
+            if (slots[i].index == -1 || slots[i].name == name) {
+                return slots[i].index;
+            }
+        }
+    }
+
+    /**
+     * @brief Index of the entry whose long name starts with prefix.
+     *
+     * @return int -1 if no long name starts with prefix.
+     * @throw std::invalid_argument if several long names start with prefix.
+     */
+    constexpr int findAbbrev(std::string_view prefix) const {
+        const NameSlot* first = std::lower_bound(long_names.data(), long_names.data() + long_names.size(), prefix,
+                                                 [](const NameSlot& slot, std::string_view name) { return slot.name < name; });
+        const NameSlot* last = first;
+        while (last != long_names.data() + long_names.size() && last->name.starts_with(prefix)) {
+            ++last;
+        }
+        if (first == last) {
+            return -1;
+        }
+        if (last - first > 1) {
+            std::string candidates;
+            for (const NameSlot* slot = first; slot != last; ++slot) {
+                candidates += (slot == first ? "" : ", ") + std::string(slot->name);
+            }
+            throw std::invalid_argument("Ambiguous argument: " + std::string(prefix) + " (could be " + candidates + ")");
+        }
+        return first->index;
+    }
+};
+
+// Parser level options of the argv scanner
+struct ScanOptions {
+    bool zero_copy = false;      // values view argv (and response files) instead of being copied
+    bool response_files = false; // expand @path arguments to the arguments in the file
+    bool allow_abbrev = true;    // unambiguous prefixes of long names are accepted
+    bool exit_on_help = false;   // the help option prints the help message and exits instead of throwing HelpRequested
+};
+
+// Input arguments of the scanner: argv entries, with response files expanded in place when enabled
+class ArgInput {
+public:
+    static constexpr int kMaxResponseFileDepth = 64; // response files can include response files, guards against cycles
+
+public:
+    ArgInput(int argc, char* argv[], const ScanOptions& options, Arena& arena)
+        : argc_(argc), argv_(argv), index_(1), options_(options), arena_(arena) {
+        advance();
+    }
+
+    inline bool done() const { return done_; }
+    inline std::string_view token() const { return token_; }
+    inline ArgKind kind() const { return kind_; }
+
+    // move to the next argument, classifying it once
+    void advance() {
+        while (true) {
+            std::string_view token;
+            if (!response_files_.empty()) {
+                ResponseFileTokenizer::Token file_token;
+                if (!response_files_.back().tokenizer.next(file_token)) {
+                    finished_files_.push_back(std::move(response_files_.back().file)); // tokens may still be viewed
+                    response_files_.pop_back();
+                    continue;
+                }
+                token = file_token.raw;
+                if (!file_token.plain) { // unescape into the arena, the length can only shrink
+                    char* data = arena_.allocate<char>(token.size());
+                    token = std::string_view(data, ResponseFileTokenizer::unescape(token, data));
+                }
+            } else if (index_ < argc_) {
+                token = argv_[index_++];
+            } else {
+                done_ = true;
+                return;
+            }
+            if (options_.response_files && token.size() > 1 && token[0] == '@') {
+                openResponseFile(std::string(token.substr(1)));
+                continue;
+            }
+            token_ = token;
+            kind_ = classifyArg(token);
+            return;
+        }
+    }
+
+    // release the response files read to the end, once the tokens viewing them are stored
+    void releaseFinished() {
+        finished_files_.clear();
+    }
+
+private:
+    void openResponseFile(const std::string& path) {
+        if (response_files_.size() >= kMaxResponseFileDepth) {
+            throw std::invalid_argument("Too many nested response files: " + path);
+        }
+        auto file = std::make_shared<const MappedFile>(path);
+        if (options_.zero_copy) { // values view the file
+            arena_.retain(file);
+        }
+        response_files_.push_back(ResponseFile{file, ResponseFileTokenizer(file->view())});
+    }
+
+private:
+    struct ResponseFile {
+        std::shared_ptr<const MappedFile> file;
+        ResponseFileTokenizer tokenizer;
+    };
+
+    int argc_;
+    char** argv_;
+    int index_; // next argv entry
+    const ScanOptions& options_;
+    Arena& arena_;
+    std::vector<ResponseFile> response_files_; // stack of response files being read
+    std::vector<std::shared_ptr<const MappedFile>> finished_files_;
+    std::string_view token_;
+    ArgKind kind_ = ArgKind::Value;
+    bool done_ = false;
+};
+
+// Entry of the help option added to parsers, names are only used if not taken by the parser
+static inline constexpr ArgEntry helpEntry(bool short_name, bool long_name) {
+    ArgEntry entry;
+    entry.short_name = short_name ? "-h" : "";
+    entry.long_name = long_name ? "--help" : "";
+    entry.description = "show this help message and exit";
+    return entry;
+}
+
+// Width of the terminal for the help message, from $COLUMNS or the terminal of stdout, 80 if unknown
+static inline size_t terminalWidth() {
+    size_t width = 80;
+    if (const char* columns = std::getenv("COLUMNS"); columns && std::atoi(columns) > 0) {
+        width = static_cast<size_t>(std::atoi(columns));
+    } else {
+#if defined(__unix__) || defined(__APPLE__)
+        struct winsize size;
+        if (::ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_col > 0) {
+            width = size.ws_col;
+        }
+#endif
+    }
+    return std::max<size_t>(width, 40);
+}
+
+class ArgScanner;
+
+}
+
 class Args {
+    friend class detail::ArgScanner;
+
     struct ParsedArgument {
         std::string name;
-        std::vector<std::string> values;
+        std::span<const std::string_view> values; // allocated from the arena of Args, viewing the arena or argv in zero-copy mode
         bool parsed; // true if appeared in command line or has default values
     };
 
@@ -42,120 +668,1161 @@ class Args {
             if (index < 0 || index >= static_cast<int>(arg->values.size())) {
                 throw std::out_of_range("Index " + std::to_string(index) + " out of range for argument: " + arg->name);
             }
-            if constexpr (std::is_same_v<T, std::string>) {
-                return arg->values[index];
-            } else {
-                T value;
-                std::istringstream iss(arg->values[index]);
-                iss >> value;
-                if (iss.fail() || !iss.eof()) {
-                    throw std::invalid_argument("Invalid value '" + arg->values[index] + "' for argument: " + arg->name);
+            return detail::convertValue<T>(arg->values[index], arg->name);
+        }
+
+        template <typename T>
+        inline T asList() const {
+            auto arg = get();
+            if constexpr (std::is_same_v<T, std::vector<std::string>>) {
+                return std::vector<std::string>(arg->values.begin(), arg->values.end());
+            } else if constexpr (std::is_same_v<T, std::vector<std::string_view>>) {
+                return std::vector<std::string_view>(arg->values.begin(), arg->values.end());
+            } else {
+                static_assert(detail::IsVector<T>::value, "asList<T>: T must be a std::vector");
+                T values;
+                values.reserve(arg->values.size());
+                for (const auto& value : arg->values) {
+                    values.push_back(detail::convertValue<typename T::value_type>(value, arg->name));
+                }
+                return values;
+            }
+        }
+
+        /**
+         * @brief Values converted to T on iteration, without copying them, see detail::ValueView.
+         *
+         * @note Valid while the Args is alive. For example `for (int n : args["--numbers"].values<int>())`.
+         */
+        template <typename T>
+        inline detail::ValueView<T> values() const {
+            auto arg = get();
+            return detail::ValueView<T>(arg->values, arg->name);
+        }
+
+        /**
+         * @brief Values as stored, valid while the Args is alive (and argv in zero-copy mode).
+         */
+        inline std::span<const std::string_view> span() const {
+            return get()->values;
+        }
+
+    private:
+        inline std::shared_ptr<ParsedArgument> get() const {
+            auto arg = arg_.lock();
+            if (!arg) {
+                throw std::invalid_argument("Argument has been deleted");
+            }
+            return arg;
+        }
+
+    private:
+        std::weak_ptr<ParsedArgument> arg_;
+    };
+
+public:
+    inline ArgGetter operator[](const std::string& name) {
+        auto it = arguments_.find(name);
+        if (it == arguments_.end()) {
+            throw std::invalid_argument("Argument not found: " + name);
+        }
+        return ArgGetter(it->second);
+    }
+
+    inline bool has(const std::string& name) const {
+        return arguments_.find(name) != arguments_.end();
+    }
+
+    // name of the subcommand given in the command line, empty if none
+    inline const std::string& command() const {
+        return command_;
+    }
+
+    // arguments of the subcommand given in the command line
+    inline Args& commandArgs() {
+        if (!command_args_) {
+            throw std::invalid_argument("No command given");
+        }
+        return *command_args_;
+    }
+
+    // mappping from argument name to given values
+    void set(const std::string& name, const std::vector<std::string>& values = {}, bool parsed = true) {
+        auto arg = emplace(name);
+        arg->values = store(std::vector<std::string_view>(values.begin(), values.end()));
+        arg->parsed = parsed;
+    }
+
+    // mapping both short name and long name to given values
+    void set(const std::string& short_name, const std::string& long_name, const std::vector<std::string>& values = {}, bool parsed = true) {
+        auto arg = emplace(short_name, long_name);
+        arg->values = store(std::vector<std::string_view>(values.begin(), values.end()));
+        arg->parsed = parsed;
+    }
+
+    /**
+     * @brief Serialize the arguments, including the subcommand arguments, into a compact binary form.
+     *
+     * @note Names are stored once, and all names and values share one contiguous text buffer. The encoding uses
+     * @note the native byte order, it is meant for processes of the same machine (pipes, shared memory).
+     */
+    std::string serialize() const {
+        Writer writer;
+        writer.write(*this);
+        return writer.finish();
+    }
+
+    /**
+     * @brief Reconstitute arguments from serialize(), the text buffer is copied into the arena at once.
+     *
+     * @throw std::invalid_argument if data is not valid serialized arguments.
+     */
+    static Args deserialize(std::string_view data) {
+        Reader reader(data);
+        Args args;
+        char* text = args.arena_->allocate<char>(reader.text().size());
+        std::memcpy(text, reader.text().data(), reader.text().size());
+        reader.read(args, std::string_view(text, reader.text().size()));
+        return args;
+    }
+
+private:
+    static constexpr char kMagic[4] = {'A', 'C', 'L', 'A'};
+    static constexpr uint32_t kFormatVersion = 1;
+
+    /*
+    Format (native byte order):
+        header: magic[4] version:u32 text_size:u64 text[text_size]
+        args:   count:u32 argument[count] has_command:u8 (command:text args)?
+        argument: name:text aliases:u32 alias:text[aliases] parsed:u8 nvalues:u32 value:text[nvalues]
+        text:   offset:u32 length:u32, a range of the text buffer
+    */
+    class Writer {
+    public:
+        void write(const Args& args) {
+            // names mapped to each argument
+            std::unordered_map<const ParsedArgument*, size_t> positions;
+            for (size_t i = 0; i < args.argument_list_.size(); ++i) {
+                positions.emplace(args.argument_list_[i].get(), i);
+            }
+            std::vector<std::vector<std::string_view>> aliases(args.argument_list_.size());
+            for (const auto& [name, arg] : args.arguments_) {
+                aliases[positions.at(arg.get())].push_back(name);
+            }
+            put32(args.argument_list_.size());
+            for (size_t i = 0; i < args.argument_list_.size(); ++i) {
+                const auto& arg = *args.argument_list_[i];
+                putName(arg.name);
+                put32(aliases[i].size());
+                for (std::string_view alias : aliases[i]) {
+                    putName(alias);
+                }
+                body_ += static_cast<char>(arg.parsed);
+                put32(arg.values.size());
+                for (std::string_view value : arg.values) {
+                    putText(value);
+                }
+            }
+            bool has_command = args.command_args_ != nullptr;
+            body_ += static_cast<char>(has_command);
+            if (has_command) {
+                putName(args.command_);
+                write(*args.command_args_);
+            }
+        }
+
+        std::string finish() const {
+            uint64_t text_size = text_.size();
+            std::string data;
+            data.reserve(sizeof(kMagic) + sizeof(kFormatVersion) + sizeof(text_size) + text_.size() + body_.size());
+            data.append(kMagic, sizeof(kMagic));
+            data.append(reinterpret_cast<const char*>(&kFormatVersion), sizeof(kFormatVersion));
+            data.append(reinterpret_cast<const char*>(&text_size), sizeof(text_size));
+            data += text_;
+            data += body_;
+            return data;
+        }
+
+    private:
+        void put32(size_t value) {
+            if (value > UINT32_MAX) {
+                throw std::invalid_argument("Arguments too large to serialize");
+            }
+            uint32_t value32 = static_cast<uint32_t>(value);
+            body_.append(reinterpret_cast<const char*>(&value32), sizeof(value32));
+        }
+
+        void putText(std::string_view text) {
+            put32(text_.size());
+            put32(text.size());
+            text_ += text;
+        }
+
+        // names are interned, each distinct name is stored once
+        void putName(std::string_view name) {
+            auto [it, inserted] = names_.try_emplace(std::string(name), text_.size());
+            if (inserted) {
+                text_ += name;
+            }
+            put32(it->second);
+            put32(name.size());
+        }
+
+    private:
+        std::string text_;
+        std::string body_;
+        std::unordered_map<std::string, size_t> names_; // offset of each name in text_
+    };
+
+    class Reader {
+    public:
+        explicit Reader(std::string_view data) : data_(data) {
+            uint32_t version = 0;
+            uint64_t text_size = 0;
+            if (data_.size() < sizeof(kMagic) + sizeof(version) + sizeof(text_size) ||
+                std::memcmp(data_.data(), kMagic, sizeof(kMagic)) != 0) {
+                throw std::invalid_argument("Invalid serialized arguments");
+            }
+            position_ = sizeof(kMagic);
+            get(version);
+            if (version != kFormatVersion) {
+                throw std::invalid_argument("Unsupported serialized arguments version: " + std::to_string(version));
+            }
+            get(text_size);
+            if (text_size > data_.size() - position_) {
+                throw std::invalid_argument("Invalid serialized arguments");
+            }
+            text_ = data_.substr(position_, text_size);
+            position_ += text_size;
+        }
+
+        inline std::string_view text() const {
+            return text_;
+        }
+
+        // read args whose text views text, a copy of text()
+        void read(Args& args, std::string_view text) {
+            uint32_t count = get32();
+            if (count > (data_.size() - position_) / kMinArgumentSize) { // corrupted count, do not reserve for it
+                throw std::invalid_argument("Invalid serialized arguments");
+            }
+            args.reserve(count);
+            for (uint32_t i = 0; i < count; ++i) {
+                auto arg = std::make_shared<ParsedArgument>();
+                arg->name = getText(text);
+                args.argument_list_.push_back(arg);
+                uint32_t naliases = get32();
+                for (uint32_t j = 0; j < naliases; ++j) {
+                    args.arguments_.emplace(getText(text), arg);
+                }
+                arg->parsed = getByte() != 0;
+                uint32_t nvalues = get32();
+                if (nvalues > (data_.size() - position_) / (2 * sizeof(uint32_t))) {
+                    throw std::invalid_argument("Invalid serialized arguments");
+                }
+                std::string_view* values = args.arena_->allocate<std::string_view>(nvalues);
+                for (uint32_t j = 0; j < nvalues; ++j) {
+                    values[j] = getText(text);
+                }
+                arg->values = std::span<const std::string_view>(values, nvalues);
+            }
+            if (getByte() != 0) {
+                args.command_ = getText(text);
+                args.command_args_ = std::make_shared<Args>();
+                args.command_args_->arena_ = args.arena_;
+                read(*args.command_args_, text);
+            }
+        }
+
+    private:
+        static constexpr size_t kMinArgumentSize = 17; // name, aliases, parsed and nvalues
+
+        template <typename T>
+        void get(T& value) {
+            if (sizeof(T) > data_.size() - position_) {
+                throw std::invalid_argument("Invalid serialized arguments");
+            }
+            std::memcpy(&value, data_.data() + position_, sizeof(T));
+            position_ += sizeof(T);
+        }
+
+        uint32_t get32() {
+            uint32_t value = 0;
+            get(value);
+            return value;
+        }
+
+        char getByte() {
+            char value = 0;
+            get(value);
+            return value;
+        }
+
+        std::string_view getText(std::string_view text) {
+            uint32_t offset = get32();
+            uint32_t length = get32();
+            if (offset > text.size() || length > text.size() - offset) {
+                throw std::invalid_argument("Invalid serialized arguments");
+            }
+            return text.substr(offset, length);
+        }
+
+    private:
+        std::string_view data_;
+        std::string_view text_;
+        size_t position_ = 0;
+    };
+
+    // copy values into the arena, without their characters
+    std::span<const std::string_view> view(std::span<const std::string_view> values) {
+        std::string_view* stored = arena_->allocate<std::string_view>(values.size());
+        std::copy(values.begin(), values.end(), stored);
+        return std::span<const std::string_view>(stored, values.size());
+    }
+
+    // copy values and their characters into the arena
+    std::span<const std::string_view> store(std::span<const std::string_view> values) {
+        std::string_view* stored = arena_->allocate<std::string_view>(values.size());
+        for (size_t i = 0; i < values.size(); ++i) {
+            stored[i] = arena_->copy(values[i]);
+        }
+        return std::span<const std::string_view>(stored, values.size());
+    }
+
+    void reserve(size_t narguments) {
+        arguments_.reserve(narguments * 2);
+        argument_list_.reserve(narguments);
+    }
+
+    // find or create the argument mapped by name
+    std::shared_ptr<ParsedArgument> emplace(std::string_view name) {
+        std::shared_ptr<ParsedArgument> arg;
+        auto it = arguments_.find(name);
+        if (it == arguments_.end()) { // not found, create new argument
+            arg = std::make_shared<ParsedArgument>();
+            argument_list_.push_back(arg);
+            arguments_.emplace(name, argument_list_.back());
+        } else { // already exists, use it
+            arg = it->second;
+        }
+        arg->name = name;
+        return arg;
+    }
+
+    // find or create the argument mapped by both short name and long name
+    std::shared_ptr<ParsedArgument> emplace(std::string_view short_name, std::string_view long_name) {
+        std::shared_ptr<ParsedArgument> arg;
+        auto short_name_it = arguments_.find(short_name);
+        auto long_name_it = arguments_.find(long_name);
+        if (short_name_it == arguments_.end() && long_name_it == arguments_.end()) { // both not found, create new argument and map both names to it
+            arg = std::make_shared<ParsedArgument>();
+            argument_list_.push_back(arg);
+            // map both names to it
+            arguments_.emplace(short_name, argument_list_.back());
+            arguments_.emplace(long_name, argument_list_.back());
+        } else if (short_name_it != arguments_.end() && long_name_it == arguments_.end()) { // only short name found, map long name to it
+            arg = short_name_it->second;
+            // map long name to it
+            arguments_.emplace(long_name, arg);
+        } else if (short_name_it == arguments_.end() /* && long_name_it != arguments_.end() */) { // only long name found, map short name to it
+            arg = long_name_it->second;
+            // map short name to it
+            arguments_.emplace(short_name, arg);
+        } else { // both found, check if they are the same argument
+            if (short_name_it->second != long_name_it->second) {
+                throw std::invalid_argument("Short name and long name are mapped to different arguments: " + std::string(short_name) + ", " + std::string(long_name));
+            }
+            // same argument, use it
+            arg = short_name_it->second;
+        }
+        arg->name = short_name;
+        return arg;
+    }
+
+    std::unordered_map<std::string, std::shared_ptr<ParsedArgument>, detail::StringHash, std::equal_to<>> arguments_;
+    std::vector<std::shared_ptr<ParsedArgument>> argument_list_;
+    std::shared_ptr<detail::Arena> arena_ = std::make_shared<detail::Arena>(); // shared by copies and command arguments, as the parsed arguments are
+    std::string command_;
+    std::shared_ptr<Args> command_args_;
+};
+
+namespace detail {
+
+/**
+ * @brief Levenshtein distance from a fixed pattern to candidate texts, bounded by a maximum distance.
+ *
+ * @note Uses the bit-parallel algorithm of Myers (Hyyrö's formulation), one column of the DP matrix per character of
+ * @note the text in a few word operations. Patterns longer than 64 characters never match.
+ */
+class BoundedEditDistance {
+public:
+    BoundedEditDistance(std::string_view pattern, size_t max_distance)
+        : pattern_size_(pattern.size()), max_distance_(max_distance) {
+        if (pattern_size_ == 0 || pattern_size_ > 64) {
+            return;
+        }
+        for (size_t i = 0; i < pattern_size_; ++i) {
+            peq_[static_cast<unsigned char>(pattern[i])] |= uint64_t(1) << i;
+        }
+    }
+
+    inline size_t maxDistance() const { return max_distance_; }
+
+    // distance from the pattern to text, max_distance + 1 if greater
+    size_t operator()(std::string_view text) const {
+        size_t too_far = max_distance_ + 1;
+        if (pattern_size_ == 0 || pattern_size_ > 64) {
+            return too_far;
+        }
+        size_t length_difference = text.size() > pattern_size_ ? text.size() - pattern_size_ : pattern_size_ - text.size();
+        if (length_difference > max_distance_) {
+            return too_far;
+        }
+        uint64_t last = uint64_t(1) << (pattern_size_ - 1);
+        uint64_t pv = ~uint64_t(0); // vertical positive deltas
+        uint64_t mv = 0;            // vertical negative deltas
+        size_t score = pattern_size_;
+        for (size_t j = 0; j < text.size(); ++j) {
+            uint64_t eq = peq_[static_cast<unsigned char>(text[j])];
+            uint64_t xv = eq | mv;
+            uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+            uint64_t ph = mv | ~(xh | pv);
+            uint64_t mh = pv & xh;
+            if (ph & last) {
+                ++score;
+            } else if (mh & last) {
+                --score;
+            }
+            ph = (ph << 1) | 1; // the first row is the distance from the empty pattern
+            mh <<= 1;
+            pv = mh | ~(xv | ph);
+            mv = ph & xv;
+            // each remaining character lowers the score by at most 1
+            if (score > max_distance_ + (text.size() - j - 1)) {
+                return too_far;
+            }
+        }
+        return std::min(score, too_far);
+    }
+
+private:
+    uint64_t peq_[256] = {}; // positions of each character in the pattern
+    size_t pattern_size_;
+    size_t max_distance_;
+};
+
+// Closest of the considered candidates to a mistyped name, names are compared without their leading dashes
+class ClosestName {
+public:
+    explicit ClosestName(std::string_view name)
+        : dashes_(leadingDashes(name)), body_size_(name.size() - dashes_),
+          distance_(name.substr(dashes_), std::max<size_t>(1, body_size_ / 3)), best_distance_(distance_.maxDistance() + 1) {}
+
+    void consider(std::string_view candidate) {
+        // a short name is only a typo of a short name, a long name of a long name
+        if (candidate.empty() || leadingDashes(candidate) != dashes_) {
+            return;
+        }
+        size_t distance = distance_(candidate.substr(dashes_));
+        if (distance < best_distance_ && distance < body_size_) { // not a replacement of the whole name
+            best_ = candidate;
+            best_distance_ = distance;
+        }
+    }
+
+    // " (did you mean X?)", empty if no candidate is close enough
+    std::string suggestion() const {
+        return best_.empty() ? std::string() : " (did you mean " + std::string(best_) + "?)";
+    }
+
+private:
+    static size_t leadingDashes(std::string_view name) {
+        return std::min<size_t>(name.find_first_not_of('-'), std::min<size_t>(name.size(), 2));
+    }
+
+private:
+    size_t dashes_;
+    size_t body_size_;
+    BoundedEditDistance distance_;
+    std::string_view best_;
+    size_t best_distance_; // starts past the bound, so only close enough candidates are kept
+};
+
+static inline std::string suggestOption(std::string_view name, std::span<const ArgEntry> entries) {
+    ClosestName closest(name);
+    for (const auto& arg : entries) {
+        closest.consider(arg.short_name);
+        closest.consider(arg.long_name);
+    }
+    return closest.suggestion();
+}
+
+static inline std::string suggestCommand(std::string_view name, std::span<const CommandInfo> commands) {
+    ClosestName closest(name);
+    for (const auto& command : commands) {
+        closest.consider(command.name);
+    }
+    return closest.suggestion();
+}
+
+// Renders the help message of a compiled argument table
+class HelpFormatter {
+public:
+    static constexpr size_t kHelpPosition = 24; // column of argument descriptions
+
+public:
+    static std::string render(const ArgTable& table, size_t width) {
+        std::string help;
+        help.reserve(4096);
+        // usage
+        help += "usage: ";
+        if (!table.usage.empty()) {
+            help += table.usage;
+            help += '\n';
+        } else {
+            appendUsage(help, table, width);
+        }
+        // description
+        if (!table.description.empty()) {
+            help += '\n';
+            appendWrapped(help, table.description, 0, 0, width);
+            help += '\n';
+        }
+        // positional arguments, options and subcommands
+        bool has_options = false;
+        if (!table.positionals.empty()) {
+            help += "\npositional arguments:\n";
+            for (int index : table.positionals) {
+                appendArgument(help, table.entries[index], width);
+            }
+        }
+        for (const auto& arg : table.entries) {
+            has_options = has_options || arg.position_name.empty();
+        }
+        if (has_options) {
+            help += "\noptions:\n";
+            for (const auto& arg : table.entries) {
+                if (arg.position_name.empty()) {
+                    appendArgument(help, arg, width);
+                }
+            }
+        }
+        if (!table.command_list.empty()) {
+            help += "\ncommands:\n";
+            for (const auto& command : table.command_list) {
+                appendItem(help, command.name, command.description, width);
+            }
+        }
+        // epilog
+        if (!table.epilog.empty()) {
+            help += '\n';
+            appendWrapped(help, table.epilog, 0, 0, width);
+            help += '\n';
+        }
+        return help;
+    }
+
+private:
+    // placeholder of the values of arg
+    static std::string metavar(const ArgEntry& arg) {
+        if (!arg.usage.empty()) {
+            return std::string(arg.usage);
+        }
+        if (arg.check && !arg.check->choices.empty()) { // {a,b,c}
+            std::string choices = "{";
+            for (std::string_view choice : arg.check->choices.list()) {
+                choices += std::string(choice) + ",";
+            }
+            choices.back() = '}';
+            return choices;
+        }
+        if (!arg.position_name.empty()) {
+            return std::string(arg.position_name);
+        }
+        std::string_view name = !arg.long_name.empty() ? arg.long_name.substr(2) : arg.short_name.substr(1);
+        std::string metavar;
+        for (char c : name) {
+            metavar += c == '-' ? '_' : static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        }
+        return metavar;
+    }
+
+    // values of arg, for example " X", " [X]", " [X ...]"
+    static std::string valuesSyntax(const ArgEntry& arg) {
+        std::string name = metavar(arg);
+        std::string syntax;
+        int required = std::max(arg.min_nvalues, 0);
+        for (int i = 0; i < required; ++i) {
+            syntax += " " + name;
+        }
+        if (arg.min_nvalues == -1 || arg.max_nvalues - required > 1) {
+            syntax += " [" + name + " ...]";
+        } else if (arg.max_nvalues > required) {
+            syntax += " [" + name + "]";
+        }
+        return syntax;
+    }
+
+    static void appendUsage(std::string& help, const ArgTable& table, size_t width) {
+        std::vector<std::string> parts;
+        for (size_t index = 0; index < table.entries.size(); ++index) {
+            const auto& arg = table.entries[index];
+            if (arg.position_name.empty()) {
+                std::string syntax = std::string(displayName(arg)) + valuesSyntax(arg);
+                bool required = !table.constraints.required.empty() && testBit(table.constraints.required, index);
+                parts.push_back(required ? syntax : "[" + syntax + "]");
+            }
+        }
+        for (int index : table.positionals) {
+            std::string syntax = valuesSyntax(table.entries[index]).substr(1); // drop leading space
+            parts.push_back(std::move(syntax));
+        }
+        if (!table.command_list.empty()) {
+            std::string commands = "{";
+            for (const auto& command : table.command_list) {
+                commands += std::string(command.name) + (&command == &table.command_list.back() ? "}" : ",");
+            }
+            parts.push_back(commands + " ...");
+        }
+        help += table.prog;
+        size_t indent = std::min<size_t>(7 + table.prog.size() + 1, width / 2); // "usage: " + prog + " "
+        size_t column = 7 + table.prog.size();
+        for (const auto& part : parts) {
+            if (column + 1 + part.size() > width && column > indent) {
+                help += '\n' + std::string(indent, ' ');
+                column = indent;
+            } else if (column > 7) { // no space after "usage: " without program name
+                help += ' ';
+                ++column;
+            }
+            help += part;
+            column += part.size();
+        }
+        help += '\n';
+    }
+
+    static void appendArgument(std::string& help, const ArgEntry& arg, size_t width) {
+        std::string invocation;
+        if (!arg.position_name.empty()) {
+            invocation = metavar(arg);
+        } else {
+            invocation = std::string(arg.short_name);
+            invocation += !arg.short_name.empty() && !arg.long_name.empty() ? ", " : "";
+            invocation += std::string(arg.long_name) + valuesSyntax(arg);
+        }
+        std::string description = std::string(arg.description);
+        if (!arg.default_values.empty()) {
+            description += description.empty() ? "(default:" : " (default:";
+            for (const auto& value : arg.default_values) {
+                description += " " + std::string(value);
+            }
+            description += ")";
+        }
+        if (arg.hooks && !arg.hooks->env.empty()) {
+            description += (description.empty() ? "[env: " : " [env: ") + arg.hooks->env + "]";
+        }
+        appendItem(help, invocation, description, width);
+    }
+
+    // "  invocation  description", the description is wrapped at kHelpPosition
+    static void appendItem(std::string& help, std::string_view invocation, std::string_view description, size_t width) {
+        size_t position = std::min(kHelpPosition, width / 3);
+        help += "  ";
+        help += invocation;
+        if (description.empty()) {
+            help += '\n';
+            return;
+        }
+        size_t column = 2 + invocation.size();
+        if (column + 2 > position) { // no room, description starts on the next line
+            help += '\n';
+            column = 0;
+        }
+        help += std::string(position - column, ' ');
+        appendWrapped(help, description, position, position, width);
+        help += '\n';
+    }
+
+    // append text word by word from column, lines are wrapped at width and indented by indent
+    static void appendWrapped(std::string& help, std::string_view text, size_t indent, size_t column, size_t width) {
+        size_t line_begin = column;
+        size_t position = 0;
+        while (position < text.size()) {
+            if (text[position] == '\n') { // explicit line break
+                help += '\n' + std::string(indent, ' ');
+                column = line_begin = indent;
+                ++position;
+                continue;
+            }
+            if (text[position] == ' ' || text[position] == '\t') {
+                ++position;
+                continue;
+            }
+            size_t end = std::min(text.find_first_of(" \t\n", position), text.size());
+            std::string_view word = text.substr(position, end - position);
+            if (column > line_begin) {
+                if (column + 1 + word.size() > width) {
+                    help += '\n' + std::string(indent, ' ');
+                    column = line_begin = indent;
+                } else {
+                    help += ' ';
+                    ++column;
+                }
+            }
+            help += word;
+            column += word.size();
+            position = end;
+        }
+    }
+};
+
+// Help message of a table rendered once per terminal width, shared by the threads parsing with the table
+class HelpCache {
+public:
+    HelpCache() = default;
+    HelpCache(const HelpCache&) {} // a copy belongs to another table
+
+    HelpCache& operator=(const HelpCache&) {
+        clear();
+        return *this;
+    }
+
+    // message for the current terminal width, render(width) is only called if it is not cached
+    template <typename Render>
+    std::shared_ptr<const std::string> get(Render&& render) const {
+        size_t width = terminalWidth();
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!help_ || width_ != width) {
+            help_ = std::make_shared<const std::string>(render(width));
+            width_ = width;
+        }
+        return help_;
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        help_.reset();
+    }
+
+private:
+    mutable std::mutex mutex_;
+    mutable std::shared_ptr<const std::string> help_;
+    mutable size_t width_ = 0;
+};
+
+// Cache of a table that cannot own one (a compile-time parser), found by the content of the table
+static inline const HelpCache& sharedHelpCache(const ArgTable& table) {
+    uint64_t key = 14695981039346656037ull; // FNV-1a of the fields shown in the help message
+    auto mix = [&key](std::string_view text) {
+        for (char c : text) {
+            key = (key ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+        }
+        key = (key ^ 0xff) * 1099511628211ull; // separator, 0xff is not in UTF-8 text
+    };
+    for (const auto& entry : table.entries) {
+        for (std::string_view text : {entry.position_name, entry.short_name, entry.long_name, entry.description, entry.usage}) {
+            mix(text);
+        }
+        for (std::string_view value : entry.default_values) {
+            mix(value);
+        }
+        mix(std::to_string(entry.min_nvalues) + ' ' + std::to_string(entry.max_nvalues));
+    }
+    for (std::string_view text : {table.prog, table.usage, table.description, table.epilog}) {
+        mix(text);
+    }
+    static std::mutex mutex;
+    static std::unordered_map<uint64_t, HelpCache> caches; // references stay valid when the map grows
+    std::lock_guard<std::mutex> lock(mutex);
+    return caches[key];
+}
+
+// Help message of table for the current terminal width
+static inline std::shared_ptr<const std::string> renderHelp(const ArgTable& table) {
+    const HelpCache& cache = table.help_cache ? *table.help_cache : sharedHelpCache(table);
+    return cache.get([&table](size_t width) { return HelpFormatter::render(table, width); });
+}
+
+// Scans argv against a compiled argument table
+class ArgScanner {
+public:
+    static Args scan(const ArgTable& table, int argc, char* argv[], const ScanOptions& options) {
+        Args args; // data structure to store parsed arguments
+        ArgInput input(argc, argv, options, *args.arena_);
+        scan(table, input, options, args);
+        return args;
+    }
+
+    /**
+     * @brief Parse argv as a program, the help option throws HelpRequested, or prints the help message and
+     * exits with options.exit_on_help.
+     *
+     * @note The program name in the help message is argv[0] if the table has none. The table is not modified.
+     */
+    static Args parse(ArgTable table, int argc, char* argv[], const ScanOptions& options) {
+        if (table.prog.empty() && argc > 0) {
+            table.prog = argv[0];
+        }
+        try {
+            return scan(table, argc, argv, options);
+        } catch (const HelpRequested& help) {
+            if (!options.exit_on_help) {
+                throw;
+            }
+            std::fputs(help.what(), stdout);
+            std::exit(0);
+        }
+    }
+
+    /**
+     * @brief Parse the rest of input as the arguments of subcommand name, into the command arguments of args.
+     *
+     * @note input must be positioned after the command name.
+     */
+    static void scanCommand(std::string_view name, const ArgTable& table, ArgInput& input, const ScanOptions& options, Args& args) {
+        args.command_ = name;
+        args.command_args_ = std::make_shared<Args>();
+        args.command_args_->arena_ = args.arena_; // the input may view the arena of args
+        scan(table, input, options, *args.command_args_);
+    }
+
+private:
+    // Buffers of a scan, reused by the later scans of the same thread
+    struct Scratch {
+        std::vector<std::shared_ptr<Args::ParsedArgument>> parsed_args; // by entry index, null if not given
+        std::vector<std::string_view> values; // values of the current argument, reused between arguments
+        std::vector<uint64_t> seen;           // bitset of the entries given in the command line
+        std::vector<uint64_t> provided;       // seen, and the entries taken from the environment or a config file
+    };
+
+    // Scratch of the current thread for the duration of a scan, one per nesting level of subcommands
+    class ScratchLease {
+    public:
+        ScratchLease(size_t nentries) {
+            if (depth_ == pool_.size()) {
+                pool_.push_back(std::make_unique<Scratch>());
+            }
+            scratch_ = pool_[depth_++].get();
+            scratch_->parsed_args.assign(nentries, nullptr);
+            scratch_->seen.assign(bitsetWords(nentries), 0);
+            scratch_->provided.assign(bitsetWords(nentries), 0);
+        }
+        ~ScratchLease() {
+            scratch_->parsed_args.clear(); // release the parsed arguments
+            scratch_->values.clear();
+            --depth_;
+        }
+        ScratchLease(const ScratchLease&) = delete;
+        ScratchLease& operator=(const ScratchLease&) = delete;
+
+        inline Scratch& operator*() const { return *scratch_; }
+
+    private:
+        static inline thread_local std::vector<std::unique_ptr<Scratch>> pool_;
+        static inline thread_local size_t depth_ = 0;
+        Scratch* scratch_;
+    };
+
+    static void scan(const ArgTable& table, ArgInput& input, const ScanOptions& options, Args& args) {
+        args.reserve(table.entries.size());
+        ScratchLease scratch(table.entries.size());
+        auto& parsed_args = (*scratch).parsed_args;
+        auto& values = (*scratch).values;
+        auto& seen = (*scratch).seen;
+        size_t positional_count = 0;
+        while (!input.done()) {
+            std::string_view input_arg = input.token();
+            bool is_option = input.kind() != ArgKind::Value;
+            int index; // index of the entry corresponding to input_arg
+            std::string_view arg_name = input_arg; // name of the option in input_arg
+            values.clear();
+            if (is_option) { // case option argument
+                // check argument exists, an exact name wins over the GNU style forms below
+                index = table.find(input_arg);
+                if (index == -1 && input.kind() == ArgKind::LongName) {
+                    // --name=value, the value is a view into input_arg
+                    if (size_t equal = input_arg.find('='); equal != std::string_view::npos) {
+                        arg_name = input_arg.substr(0, equal);
+                        values.push_back(input_arg.substr(equal + 1));
+                        index = table.find(arg_name);
+                    }
+                    if (index == -1 && options.allow_abbrev) {
+                        index = table.findAbbrev(arg_name);
+                    }
+                } else if (index == -1 && input.kind() == ArgKind::ShortName && input_arg.size() > 2) {
+                    index = scanCluster(table, input_arg, options, *scratch, args);
+                    arg_name = index == -1 ? input_arg : table.entries[index].short_name;
+                }
+                if (index == -1) {
+                    throw std::invalid_argument("Unknown argument: " + std::string(arg_name) +
+                                                suggestOption(arg_name, table.entries));
+                }
+                if (index == table.help_index) {
+                    throw HelpRequested(*renderHelp(table));
+                }
+                const ArgEntry& arg = table.entries[index];
+                if (!values.empty() && arg.min_nvalues == 0 && arg.max_nvalues == 0) {
+                    throw std::invalid_argument("Argument takes no values: " + std::string(arg_name));
+                }
+                input.advance(); // skip argument name
+            } else { // case positional argument
+                // the first positional argument is the subcommand when the parser has subcommands,
+                // the rest of the input belongs to the subcommand
+                if (table.commands) {
+                    if (!(*table.commands)(table.prog, input_arg, input, args)) {
+                        throw std::invalid_argument("Unknown command: " + std::string(input_arg) +
+                                                    suggestCommand(input_arg, table.command_list));
+                    }
+                    break;
+                }
+                // check number of positional arguments is valid
+                if (positional_count >= table.positionals.size()) {
+                    throw std::invalid_argument("Too many positional arguments");
+                }
+                index = table.positionals[positional_count++];
+            }
+            const ArgEntry& arg = table.entries[index];
+            // parse argument values, greedy consume values until next option argument
+            // (input_arg is the first value of a positional argument, which takes at least one value when given)
+            size_t max_nvalues = arg.min_nvalues == -1 ? SIZE_MAX : static_cast<size_t>(arg.max_nvalues);
+            size_t count = values.size();
+            bool streamed = arg.hooks && arg.hooks->on_value;
+            if (streamed) { // values are passed on one at a time and never collected
+                for (std::string_view value : values) {
+                    stream(arg, value);
+                }
+                values.clear();
+            }
+            while (count < max_nvalues && !input.done() && input.kind() == ArgKind::Value) {
+                if (streamed) {
+                    stream(arg, input.token());
+                } else {
+                    values.push_back(input.token());
+                }
+                input.advance();
+                ++count;
+                if (streamed) {
+                    input.releaseFinished();
+                }
+            }
+            int nvalues = static_cast<int>(std::min<size_t>(count, INT_MAX));
+            // check number of values is valid
+            if (nvalues < arg.min_nvalues) {
+                std::string_view name = is_option ? arg_name : arg.position_name;
+                throw std::invalid_argument("Not enough values for argument: " + std::string(name));
+            }
+            set(args, arg, parsed_args[index], values, options);
+            setBit(seen, index);
+            input.releaseFinished();
+        }
+        checkExclusive(table, seen);
+        // add values for the arguments not given, from the environment variable, or the default values
+        // (values from config files are merged into the default values of the table)
+        auto& provided = (*scratch).provided;
+        provided = seen;
+        for (size_t index = 0; index < table.entries.size(); ++index) {
+            if (testBit(seen, index)) {
+                continue;
+            }
+            const auto& arg = table.entries[index];
+            std::span<const std::string_view> fallback_values = arg.default_values;
+            bool parsed = !arg.default_values.empty() || arg.default_parsed; // if default values are set, the argument is considered parsed
+            if (arg.configured) {
+                setBit(provided, index);
+            }
+            if (arg.hooks && !arg.hooks->env.empty() && readEnv(arg, values, parsed)) {
+                check(arg, values);
+                fallback_values = values;
+                setBit(provided, index);
+            }
+            auto parsed_arg = emplace(args, arg);
+            if (arg.hooks && arg.hooks->bind) { // bound argument, values are not stored
+                if (parsed) {
+                    arg.hooks->bind(fallback_values);
+                }
+            } else if (arg.hooks && arg.hooks->on_value) { // streamed argument, values are not stored
+                if (parsed) {
+                    for (std::string_view value : fallback_values) {
+                        arg.hooks->on_value(value);
+                    }
+                }
+            } else {
+                parsed_arg->values = args.store(fallback_values);
+            }
+            parsed_arg->parsed = parsed;
+        }
+        // check the remaining positional arguments have enough values, unless the environment or a config file gave them
+        for (size_t i = positional_count; i < table.positionals.size(); ++i) {
+            const auto& arg = table.entries[table.positionals[i]];
+            if (arg.min_nvalues > 0 && !testBit(provided, table.positionals[i])) { // 0 for optional, -1 for variadic
+                throw std::invalid_argument("Not enough values for argument: " + std::string(arg.position_name));
+            }
+        }
+        checkRequired(table, provided);
+    }
+
+    // At most one argument of each exclusive group in the command line
+    static void checkExclusive(const ArgTable& table, std::span<const uint64_t> seen) {
+        size_t nwords = seen.size();
+        for (size_t group = 0; group < table.constraints.exclusive.size(); group += nwords) {
+            int count = 0;
+            for (size_t w = 0; w < nwords; ++w) {
+                count += std::popcount(seen[w] & table.constraints.exclusive[group + w]);
+            }
+            if (count > 1) {
+                std::vector<std::string_view> names;
+                for (size_t i = 0; names.size() < 2; ++i) {
+                    if (testBit(seen, i) && testBit(table.constraints.exclusive.subspan(group, nwords), i)) {
+                        names.push_back(displayName(table.entries[i]));
+                    }
+                }
+                throw std::invalid_argument("Arguments " + std::string(names[0]) + " and " + std::string(names[1]) +
+                                            " are mutually exclusive");
+            }
+        }
+    }
+
+    // Required arguments and the dependencies of the provided arguments are provided
+    static void checkRequired(const ArgTable& table, std::span<const uint64_t> provided) {
+        size_t nwords = provided.size();
+        for (size_t w = 0; w < table.constraints.required.size(); ++w) {
+            if (uint64_t missing = table.constraints.required[w] & ~provided[w]) {
+                const auto& arg = table.entries[w * 64 + std::countr_zero(missing)];
+                throw std::invalid_argument("Missing required argument: " + std::string(displayName(arg)));
+            }
+        }
+        for (size_t k = 0; k < table.constraints.dependents.size(); ++k) {
+            int dependent = table.constraints.dependents[k];
+            if (!testBit(provided, dependent)) {
+                continue;
+            }
+            for (size_t w = 0; w < nwords; ++w) {
+                if (uint64_t missing = table.constraints.dependencies[k * nwords + w] & ~provided[w]) {
+                    const auto& arg = table.entries[w * 64 + std::countr_zero(missing)];
+                    throw std::invalid_argument("Argument " + std::string(displayName(table.entries[dependent])) +
+                                                " requires " + std::string(displayName(arg)));
                 }
-                return value;
             }
         }
+    }
 
-        template <typename T>
-        inline T asList() const {
-            auto arg = get();
-            if constexpr (std::is_same_v<T, std::vector<std::string>>) {
-                return arg->values;
-            } else {
-                std::vector<T> values;
-                for (const auto& value : arg->values) {
-                    T v;
-                    std::istringstream iss(value);
-                    iss >> v;
-                    if (iss.fail() || !iss.eof()) {
-                        throw std::invalid_argument("Invalid value '" + value + "' for argument: " + arg->name);
-                    }
-                    values.push_back(v);
+    /**
+     * @brief Scan a cluster of short options, `-abc` for `-a -b -c` and `-j8` for `-j 8`.
+     *
+     * @note Every option but the last must be a flag and is set here. The characters after an option that takes
+     * @note values are its first value, pushed to values as a view into cluster.
+     * @return int Index of the last option of the cluster, -1 if the first option is unknown.
+     */
+    static int scanCluster(const ArgTable& table, std::string_view cluster, const ScanOptions& options, Scratch& scratch,
+                           Args& args) {
+        for (size_t position = 1; position < cluster.size(); ++position) {
+            const char name[2] = {'-', cluster[position]};
+            int index = table.find(std::string_view(name, 2));
+            if (index == -1) {
+                if (position == 1) {
+                    return -1;
                 }
-                return values;
+                throw std::invalid_argument("Unknown argument: " + std::string(name, 2) + " in " + std::string(cluster));
+            }
+            const ArgEntry& arg = table.entries[index];
+            bool flag = arg.min_nvalues == 0 && arg.max_nvalues == 0;
+            if (!flag || index == table.help_index || position + 1 == cluster.size()) {
+                if (!flag && position + 1 < cluster.size()) {
+                    scratch.values.push_back(cluster.substr(position + 1));
+                }
+                return index;
             }
+            set(args, arg, scratch.parsed_args[index], {}, options);
+            setBit(scratch.seen, index);
         }
+        return -1; // not reached, the cluster has at least one option
+    }
 
-    private:
-        inline std::shared_ptr<ParsedArgument> get() const {
-            auto arg = arg_.lock();
-            if (!arg) {
-                throw std::invalid_argument("Argument has been deleted");
+    // Check the constraints of arg on values, the default values are trusted
+    static inline void check(const ArgEntry& arg, std::span<const std::string_view> values) {
+        if (arg.check) {
+            for (std::string_view value : values) {
+                arg.check->check(value, displayName(arg));
             }
-            return arg;
         }
+    }
 
-    private:
-        std::weak_ptr<ParsedArgument> arg_;
-    };
-
-public:
-    inline ArgGetter operator[](const std::string& name) {
-        auto it = arguments_.find(name);
-        if (it == arguments_.end()) {
-            throw std::invalid_argument("Argument not found: " + name);
+    // Pass one value of a streamed argument to its callback
+    static inline void stream(const ArgEntry& arg, std::string_view value) {
+        if (arg.check) {
+            arg.check->check(value, displayName(arg));
         }
-        return ArgGetter(it->second);
+        arg.hooks->on_value(value);
     }
 
-    inline bool has(const std::string& name) const {
-        return arguments_.find(name) != arguments_.end();
+    // Set the values of arg given in the command line
+    static void set(Args& args, const ArgEntry& arg, std::shared_ptr<Args::ParsedArgument>& parsed_arg,
+                    std::span<const std::string_view> values, const ScanOptions& options) {
+        // bound arguments are converted while the input is alive and never stored, bind() rejects view targets
+        // bound arguments are converted while the input is alive and never stored
+        bool bound = arg.hooks && arg.hooks->bind;
+        std::span<const std::string_view> stored;
+        if (!bound) {
+            stored = options.zero_copy ? args.view(values) : args.store(values);
+        }
+        if (!parsed_arg) {
+            parsed_arg = emplace(args, arg);
+        }
+        if (bound) { // bound argument, values are not stored
+            arg.hooks->bind(values);
+        }
+        parsed_arg->values = stored;
+        parsed_arg->parsed = true;
     }
 
-    // mappping from argument name to given values
-    void set(const std::string& name, const std::vector<std::string>& values = {}, bool parsed = true) {
-        std::shared_ptr<ParsedArgument> arg;
-        auto it = arguments_.find(name);
-        if (it == arguments_.end()) { // not found, create new argument
-            arg = std::make_shared<ParsedArgument>();
-            argument_list_.push_back(arg);
-            arguments_[name] = argument_list_.back();
-        } else { // already exists, use it
-            arg = it->second;
+    /**
+     * @brief Read the values of arg from its environment variable, split by whitespace.
+     *
+     * @note An unset or empty variable is ignored. A flag (no values) is set unless the variable is "0" or "false".
+     *
+     * @return bool True if the variable is used, values are the views into the environment and parsed is updated.
+     */
+    static bool readEnv(const ArgEntry& arg, std::vector<std::string_view>& values, bool& parsed) {
+        const char* env = std::getenv(arg.hooks->env.c_str());
+        if (!env || env[0] == '\0') {
+            return false;
         }
-        // update argument values
-        arg->name = name;
-        arg->values = values;
-        arg->parsed = parsed;
+        std::string_view text = env;
+        values.clear();
+        if (arg.max_nvalues == 0 && arg.min_nvalues == 0) { // flag
+            parsed = text != "0" && text != "false";
+            return true;
+        }
+        parsed = true;
+        size_t begin = text.find_first_not_of(" \t\r\n");
+        while (begin != std::string_view::npos) {
+            size_t end = std::min(text.find_first_of(" \t\r\n", begin), text.size());
+            values.push_back(text.substr(begin, end - begin));
+            begin = text.find_first_not_of(" \t\r\n", end);
+        }
+        checkNValues(arg, values.size(), "environment variable " + arg.hooks->env);
+        return true;
     }
 
-    // mapping both short name and long name to given values
-    void set(const std::string& short_name, const std::string& long_name, const std::vector<std::string>& values = {}, bool parsed = true) {
-        std::shared_ptr<ParsedArgument> arg;
-        auto short_name_it = arguments_.find(short_name);
-        auto long_name_it = arguments_.find(long_name);
-        if (short_name_it == arguments_.end() && long_name_it == arguments_.end()) { // both not found, create new argument and map both names to it
-            arg = std::make_shared<ParsedArgument>();
-            argument_list_.push_back(arg);
-            // map both names to it
-            arguments_[short_name] = argument_list_.back();
-            arguments_[long_name] = argument_list_.back();
-        } else if (short_name_it != arguments_.end() && long_name_it == arguments_.end()) { // only short name found, map long name to it
-            arg = short_name_it->second;
-            // map long name to it
-            arguments_[long_name] = arg;
-        } else if (short_name_it == arguments_.end() /* && long_name_it != arguments_.end() */) { // only long name found, map short name to it
-            arg = long_name_it->second;
-            // map short name to it
-            arguments_[short_name] = arg;
-        } else { // both found, check if they are the same argument
-            if (short_name_it->second != long_name_it->second) {
-                throw std::invalid_argument("Short name and long name are mapped to different arguments: " + short_name + ", " + long_name);
-            }
-            // same argument, use it
-            arg = short_name_it->second;
+    // find or create the parsed argument for entry, options with both names map both names to it
+    static std::shared_ptr<Args::ParsedArgument> emplace(Args& args, const ArgEntry& arg) {
+        if (!arg.position_name.empty()) {
+            return args.emplace(arg.position_name);
         }
-        // update argument values
-        arg->name = short_name;
-        arg->values = values;
-        arg->parsed = parsed;
+        if (!arg.short_name.empty() && !arg.long_name.empty()) {
+            return args.emplace(arg.short_name, arg.long_name);
+        }
+        return args.emplace(arg.short_name.empty() ? arg.long_name : arg.short_name);
     }
-
-private:
-    std::unordered_map<std::string, std::shared_ptr<ParsedArgument>> arguments_;
-    std::vector<std::shared_ptr<ParsedArgument>> argument_list_;
 };
 
+}
+
+class FrozenArgParser;
+
 class ArgParser {
+    friend class FrozenArgParser;
+
     struct Argument {
         std::string position_name; // name in position argument
         std::string short_name;    // short option name
@@ -164,13 +1831,15 @@ class ArgParser {
         std::string usage;
         int min_nvalues;           // minimum number of values,
         int max_nvalues;           // maximum number of values, should be greater than or equal to min_nvalues
-        // TODO: required flag
+        bool required;             // must be given in the command line, the environment or a config file
+        std::vector<std::string> dependencies; // names of the arguments required when this one is given
         std::vector<std::string> default_values;
+        detail::ArgHooks hooks;
     };
 
     class ArgumentSetter {
     public:
-        ArgumentSetter(std::weak_ptr<Argument> arg) : arg_(arg) {}
+        ArgumentSetter(std::weak_ptr<Argument> arg, std::weak_ptr<uint64_t> revision) : arg_(arg), revision_(revision) {}
 
         ArgumentSetter& description(const std::string& description) {
             get()->description = description;
@@ -196,27 +1865,11 @@ class ArgParser {
          * @return ArgumentSetter& Reference to this object.
          */
         ArgumentSetter& nvalues(int min, int max = -1) {
-            // check min and max
-            if (min < -1 || max < -1 || (max != -1 && max < min)) {
-                throw std::invalid_argument("Invalid number of values: " + std::to_string(min) + ", " + std::to_string(max));
-            }
             auto arg = get();
-            // check special behavior for positional arguments
-            if (!arg->position_name.empty() && min == 0) {
-                if (max == 0) {
-                    throw std::invalid_argument("Positional argument cannot have exactly 0 values");
-                }
-                if (max == -1) {
-                    max = 1;
-                }
-            }
-            // check variadic argument (TODO: Add this to the note)
-            if (min == -1 && max != -1) {
-                throw std::invalid_argument("Variadic argument cannot have a maximum number of values");
-            }
+            detail::normalizeNValues(!arg->position_name.empty(), min, max);
             // set number of values
             arg->min_nvalues = min;
-            arg->max_nvalues = max == -1 ? min : max;
+            arg->max_nvalues = max;
             return *this;
         }
 
@@ -225,42 +1878,379 @@ class ArgParser {
             return *this;
         }
 
+        /**
+         * @brief Convert the values and store them into target during parsing, instead of into Args.
+         *
+         * @param target Variable to store into, must outlive parsing.
+         *
+         * @note A `std::vector` receives every value, a `bool` is set to `true` if the argument has no values,
+         * @note any other type receives the first value. Default values are stored the same way.
+         * @note An invalid value throws from `parse`, and the values of a bound argument are not accessible from Args.
+         * @note The target cannot be a `std::string_view`, the input it would view is released when `parse` returns.
+         *
+         * @return ArgumentSetter& Reference to this object.
+         */
+        template <typename T>
+        ArgumentSetter& bind(T* target) {
+            using Value = typename std::conditional_t<detail::IsVector<T>::value, T, std::vector<T>>::value_type;
+            static_assert(!std::is_same_v<Value, std::string_view>, "bind to std::string or use onValue to read views");
+            auto arg = get();
+            if (arg->hooks.on_value) {
+                throw std::invalid_argument("Argument cannot have both bind and onValue");
+            }
+            std::string name = !arg->position_name.empty() ? arg->position_name : !arg->short_name.empty() ? arg->short_name : arg->long_name;
+            arg->hooks.bind = [target, name](std::span<const std::string_view> values) {
+                if constexpr (detail::IsVector<T>::value) {
+                    target->clear();
+                    for (const auto& value : values) {
+                        target->push_back(detail::convertValue<typename T::value_type>(value, name));
+                    }
+                } else {
+                    if (!values.empty()) {
+                        *target = detail::convertValue<T>(values[0], name);
+                    } else if constexpr (std::is_same_v<T, bool>) {
+                        *target = true;
+                    }
+                }
+            };
+            return *this;
+        }
+
+        /**
+         * @brief Pass each value to fn as soon as it is scanned, instead of storing the values into Args.
+         *
+         * @param fn Called once per value, in order. The view is only valid during the call.
+         *
+         * @note Meant for variadic arguments with a huge number of values: the values are never collected,
+         * @note so parsing them takes constant additional memory. Values from the environment variable,
+         * @note config files or the default values are passed the same way when the argument is not given.
+         * @note The argument is parsed with no values in Args. Constraints are checked before each call,
+         * @note and fn may have received some values when parse throws. Cannot be combined with bind.
+         *
+         * @return ArgumentSetter& Reference to this object.
+         */
+        ArgumentSetter& onValue(std::function<void(std::string_view)> fn) {
+            auto arg = get();
+            if (arg->hooks.bind) {
+                throw std::invalid_argument("Argument cannot have both bind and onValue");
+            }
+            arg->hooks.on_value = std::move(fn);
+            return *this;
+        }
+
+        /**
+         * @brief Take the values from the environment variable name when the argument is not given.
+         *
+         * @note The variable is split by whitespace. A flag (no values) is set unless the variable is "0" or "false".
+         * @note Precedence: command line > environment variable > config file > default values.
+         * @note A positional argument set by the variable (or a config file) may be omitted from the command line.
+         *
+         * @return ArgumentSetter& Reference to this object.
+         */
+        ArgumentSetter& env(const std::string& name) {
+            get()->hooks.env = name;
+            return *this;
+        }
+
+        /**
+         * @brief Take the values from key of the config files when the argument is not given, see ArgParser::configFile.
+         *
+         * @return ArgumentSetter& Reference to this object.
+         */
+        ArgumentSetter& config(const std::string& key) {
+            get()->hooks.config_key = key;
+            return *this;
+        }
+
+        /**
+         * @brief The argument must be given in the command line, its environment variable or a config file.
+         *
+         * @return ArgumentSetter& Reference to this object.
+         */
+        ArgumentSetter& required(bool required = true) {
+            get()->required = required;
+            return *this;
+        }
+
+        /**
+         * @brief When this argument is given, the argument name must be given too.
+         *
+         * @param name Any name of the other argument, resolved when the parser is compiled.
+         * @return ArgumentSetter& Reference to this object.
+         */
+        ArgumentSetter& dependsOn(const std::string& name) {
+            get()->dependencies.push_back(name);
+            return *this;
+        }
+
+        /**
+         * @brief Accept only the given values.
+         *
+         * @return ArgumentSetter& Reference to this object.
+         */
+        ArgumentSetter& choices(const std::vector<std::string>& choices) {
+            get()->hooks.choices = choices;
+            return *this;
+        }
+
+        /**
+         * @brief Accept only numbers in [min, max].
+         *
+         * @return ArgumentSetter& Reference to this object.
+         */
+        ArgumentSetter& range(double min, double max) {
+            if (min > max) {
+                throw std::invalid_argument("Invalid range: min is greater than max");
+            }
+            get()->hooks.range = std::make_pair(min, max);
+            return *this;
+        }
+
+        /**
+         * @brief Accept only values matched as a whole by the regular expression pattern (ECMAScript syntax).
+         *
+         * @note The expression is compiled here, an invalid pattern throws std::regex_error.
+         * @return ArgumentSetter& Reference to this object.
+         */
+        ArgumentSetter& pattern(const std::string& pattern) {
+            auto arg = get();
+            arg->hooks.pattern = std::make_shared<const std::regex>(pattern, std::regex::ECMAScript | std::regex::optimize);
+            arg->hooks.pattern_source = pattern;
+            return *this;
+        }
+
     private:
         std::shared_ptr<Argument> get() const {
             auto arg = arg_.lock();
             if (!arg) {
                 throw std::invalid_argument("Argument has been deleted");
             }
+            if (auto revision = revision_.lock()) { // the argument is about to change
+                ++*revision;
+            }
             return arg;
         }
 
     private:
         std::weak_ptr<Argument> arg_;
+        std::weak_ptr<uint64_t> revision_; // revision of the parser
     };
 
 private:
-    static inline bool isPositional(const std::string& name) { return name.size() >= 1 && name[0] != '-'; }
-    static inline bool isShortName(const std::string& name) { return name.size() >= 2 && name[0] == '-' && name[1] != '-' && std::isalpha(name[1]); }
-    static inline bool isLongName(const std::string& name) { return name.size() >= 3 && name[0] == '-' && name[1] == '-' && std::isalpha(name[2]); }
+    static inline bool isPositional(std::string_view name) { return detail::isPositional(name); }
+    static inline bool isShortName(std::string_view name) { return detail::isShortName(name); }
+    static inline bool isLongName(std::string_view name) { return detail::isLongName(name); }
+
+    // Flattened copy of the declared arguments, views into the Argument objects of the parser
+    struct CompiledTable {
+        std::vector<detail::ArgEntry> entries;
+        std::vector<detail::NameSlot> slots;
+        std::vector<detail::NameSlot> long_names;
+        std::vector<detail::ValueCheck> checks;        // constraints of the entries, not reallocated after compile
+        // bitsets of the argument relations, see detail::ArgConstraints
+        std::vector<uint64_t> required;
+        std::vector<uint64_t> exclusive;
+        std::vector<int> dependents;
+        std::vector<uint64_t> dependencies;
+        std::vector<int> positionals;
+        std::vector<std::string_view> default_values; // storage of ArgEntry::default_values
+        detail::CommandDispatch commands;              // empty if the parser has no subcommands
+        std::vector<detail::CommandInfo> command_list;
+        std::string_view prog;
+        std::string_view usage;
+        std::string_view description;
+        std::string_view epilog;
+        int help_index = -1;
+        const detail::HelpCache* help_cache = nullptr;
+
+        detail::ArgTable table() const {
+            return {entries, slots, long_names, positionals, commands ? &commands : nullptr, command_list, prog, usage, description, epilog, help_index,
+                    help_cache, detail::ArgConstraints{required, exclusive, dependents, dependencies}};
+        }
+    };
+
+    struct Command {
+        std::function<ArgParser()> factory;
+        std::string description;
+    };
 
 public:
     ArgParser& prog(const std::string& program_name) {
         program_name_ = program_name;
+        ++*revision_;
         return *this;
     }
 
     ArgParser& usage(const std::string& usage) {
         usage_ = usage;
+        ++*revision_;
         return *this;
     }
 
     ArgParser& description(const std::string& description) {
         description_ = description;
+        ++*revision_;
         return *this;
     }
 
     ArgParser& epilog(const std::string& epilog) {
         epilog_ = epilog;
+        ++*revision_;
+        return *this;
+    }
+
+    /**
+     * @brief Add the `-h, --help` option, parse() then throws HelpRequested with the help message.
+     *
+     * @note Off by default, so that parsers do not throw anything but std::invalid_argument for the command line.
+     * @note Only the names not taken by other arguments are used.
+     */
+    ArgParser& addHelp(bool enable = true) {
+        add_help_ = enable;
+        ++*revision_;
+        return *this;
+    }
+
+    /**
+     * @brief Help message, rendered for the terminal width once and cached until the parser changes.
+     *
+     * @note The help option of parse() throws the same cached message.
+     */
+    const std::string& help() const {
+        help_ = helpCache().get([this](size_t width) { return detail::HelpFormatter::render(compile().table(), width); });
+        return *help_;
+    }
+
+    /**
+     * @brief Store parsed values as views into argv instead of copying them.
+     *
+     * @note argv must outlive the returned Args. Default values are still copied.
+     */
+    ArgParser& zeroCopy(bool enable = true) {
+        scan_options_.zero_copy = enable;
+        return *this;
+    }
+
+    /**
+     * @brief Expand `@path` arguments to the arguments read from the file at path.
+     *
+     * @note The file is split with shell-like quoting, see ResponseFileTokenizer. Response files can include response files.
+     */
+    ArgParser& responseFiles(bool enable = true) {
+        scan_options_.response_files = enable;
+        return *this;
+    }
+
+    /**
+     * @brief Accept unambiguous prefixes of long names, for example `--verb` for `--verbose` (default).
+     *
+     * @note An exact name always wins, so `--verb` is not ambiguous if `--verb` is itself an argument.
+     */
+    ArgParser& allowAbbrev(bool enable = true) {
+        scan_options_.allow_abbrev = enable;
+        return *this;
+    }
+
+    /**
+     * @brief Print the help message to stdout and exit the process when parse() sees the help option.
+     *
+     * @note Meant for the command line of main(), without it parse() throws HelpRequested for the caller to handle.
+     */
+    ArgParser& exitOnHelp(bool enable = true) {
+        scan_options_.exit_on_help = enable;
+        return *this;
+    }
+
+    /**
+     * @brief Read a config file into the lookup table used by the arguments with a config key.
+     *
+     * Each line is a key followed by its values, in the CLI script syntax:
+     * @code
+     * # comment
+     * threads 8
+     * files "a.txt" "b.txt"
+     * @endcode
+     *
+     * @note The file is parsed once, keys of later files override earlier ones. Unused keys are ignored.
+     */
+    ArgParser& configFile(const std::string& path) {
+        MappedFile file(path);
+        std::string_view source = file.view();
+        CLIStringInputStream stream(source);
+        CLILexer lexer(stream);
+        std::vector<std::string>* values = nullptr; // values of the key of current line, null before the key
+        while (true) {
+            CLIToken token = lexer.nextToken();
+            switch (token.type) {
+                case CLIToken::Type::Identifier:
+                    if (!values) { // key
+                        values = &config_[token.value];
+                        values->clear();
+                    } else {
+                        values->push_back(std::move(token.value));
+                    }
+                    break;
+                case CLIToken::Type::String:
+                    if (!values) {
+                        throw std::invalid_argument("Expected key at position " + std::to_string(token.begin) + " of config file: " + path);
+                    }
+                    values->push_back(std::move(token.value));
+                    break;
+                case CLIToken::Type::Integer:
+                case CLIToken::Type::Float:
+                    if (!values) {
+                        throw std::invalid_argument("Expected key at position " + std::to_string(token.begin) + " of config file: " + path);
+                    }
+                    values->emplace_back(source.substr(token.begin, token.end - token.begin)); // as written, token value is normalized
+                    break;
+                case CLIToken::Type::EndOfLine:
+                    values = nullptr;
+                    break;
+                case CLIToken::Type::Comment:
+                    break;
+                case CLIToken::Type::EndOfFile:
+                    ++*revision_;
+                    return *this;
+                default:
+                    throw std::invalid_argument("Unexpected " + CLIToken::toString(token.type) + " '" + token.value + "' at position " + std::to_string(token.begin) + " of config file: " + path);
+            }
+        }
+    }
+
+    /**
+     * @brief Allow at most one of the arguments names in the command line.
+     *
+     * @param names Any name of each argument, resolved when the parser is compiled.
+     */
+    ArgParser& exclusive(const std::vector<std::string>& names) {
+        if (names.size() < 2) {
+            throw std::invalid_argument("Exclusive group needs at least two arguments");
+        }
+        exclusive_groups_.push_back(names);
+        ++*revision_;
+        return *this;
+    }
+
+    /**
+     * @brief Add a subcommand, dispatched on the first positional argument.
+     *
+     * @param name Name of the subcommand.
+     * @param factory Builds the parser of the subcommand, only called when name appears in the command line.
+     * @param description Description of the subcommand in the help message.
+     *
+     * @note The arguments after the subcommand name are parsed by its parser into Args::commandArgs(),
+     * @note with the zero-copy and response file options of this parser.
+     * @note When a parser has subcommands, its first positional argument must be a subcommand name.
+     */
+    ArgParser& command(const std::string& name, std::function<ArgParser()> factory, const std::string& description = "") {
+        if (!isPositional(name)) {
+            throw std::invalid_argument("Invalid command name: " + name);
+        }
+        if (!commands_.emplace(name, Command{std::move(factory), description}).second) {
+            throw std::invalid_argument("Duplicate command name: " + name);
+        }
+        command_list_.push_back(name);
+        ++*revision_;
         return *this;
     }
 
@@ -275,6 +2265,9 @@ public:
             .long_name = isLongName(name) ? name : "",
             .min_nvalues = 0,
             .max_nvalues = 0,
+            .required = false,
+            .dependencies = {},
+            .hooks = {},
         });
         // check valid name
         if (arg->position_name.empty() && arg->short_name.empty() && arg->long_name.empty()) {
@@ -295,7 +2288,8 @@ public:
             option_list_.push_back(arg);
             arguments_[arg->short_name.empty() ? arg->long_name : arg->short_name] = option_list_.back();
         }
-        return ArgumentSetter(arg);
+        ++*revision_;
+        return ArgumentSetter(arg, revision_);
     }
 
     ArgumentSetter add(const std::string& short_name, const std::string& long_name) {
@@ -321,124 +2315,210 @@ public:
             .long_name = long_name,
             .min_nvalues = 0,
             .max_nvalues = 0,
+            .required = false,
+            .dependencies = {},
+            .hooks = {},
         });
         option_list_.push_back(std::move(arg));
         arguments_[short_name] = option_list_.back();
         arguments_[long_name] = option_list_.back();
-        return ArgumentSetter(option_list_.back());
+        ++*revision_;
+        return ArgumentSetter(option_list_.back(), revision_);
+    }
+
+    /**
+     * @brief Parse argv.
+     *
+     * @note The parser is compiled on every call, see freeze() to compile it once.
+     * @throw HelpRequested if the help option is given, unless exitOnHelp() is set.
+     */
+    Args parse(int argc, char* argv[]) const {
+        CompiledTable compiled = compile();
+        return detail::ArgScanner::parse(compiled.table(), argc, argv, scan_options_);
     }
 
-    Args parse(int argc, char* argv[]) {
-        // parse program info
-        if (program_name_.empty()) {
-            program_name_ = argv[0];
+    /**
+     * @brief Snapshot the parser into an immutable compiled parser.
+     *
+     * @note Later changes to this parser and its ArgumentSetters do not affect the frozen parser. The frozen
+     * parser never prints or exits, its parse() throws HelpRequested on the help option whatever exitOnHelp() is.
+     */
+    std::shared_ptr<const FrozenArgParser> freeze() const;
+
+private:
+    // Copy of the parser that shares no arguments with this one
+    ArgParser clone() const {
+        ArgParser parser = *this;
+        std::unordered_map<const Argument*, std::shared_ptr<Argument>> copies;
+        for (auto* list : {&parser.positional_list_, &parser.option_list_}) {
+            for (auto& arg : *list) {
+                auto copy = std::make_shared<Argument>(*arg);
+                copies.emplace(arg.get(), copy);
+                arg = std::move(copy);
+            }
         }
-        // parse arguments
-        Args args; // data structure to store parsed arguments
-        int positional_count = 0;
-        for (int i = 1; i < argc; ++i) {
-            std::string input_arg = argv[i];
-            bool is_short_name = isShortName(input_arg);
-            bool is_long_name = isLongName(input_arg);
-            std::shared_ptr<ArgCLITool::ArgParser::Argument> arg; // argument corresponding to input_arg
-            if (is_short_name || is_long_name) { // case option argument
-                // check argument exists
-                auto it = arguments_.find(input_arg);
-                if (it == arguments_.end()) {
-                    throw std::invalid_argument("Unknown argument: " + input_arg);
-                }
-                arg = it->second;
-                ++i; // skip argument name
-            } else { // case positional argument
-                // check number of positional arguments is valid
-                if (positional_count >= static_cast<int>(positional_list_.size())) {
-                    throw std::invalid_argument("Too many positional arguments");
+        for (auto& [name, arg] : parser.arguments_) {
+            arg = copies.at(arg.get());
+        }
+        parser.revision_ = std::make_shared<uint64_t>(0);
+        parser.help_revision_ = UINT64_MAX;
+        return parser;
+    }
+
+    // Cache of the help message, emptied when the parser has changed since it was rendered
+    const detail::HelpCache& helpCache() const {
+        if (help_revision_ != *revision_) {
+            help_cache_.clear();
+            help_revision_ = *revision_;
+        }
+        return help_cache_;
+    }
+
+    CompiledTable compile() const {
+        CompiledTable compiled;
+        compiled.help_cache = &helpCache();
+        // values from config files replace the default values
+        auto fallbackValues = [this](const Argument& arg) -> const std::vector<std::string>& {
+            if (!arg.hooks.config_key.empty()) {
+                auto it = config_.find(arg.hooks.config_key);
+                if (it != config_.end()) {
+                    return it->second;
                 }
-                arg = positional_list_[positional_count++];
             }
-            // parse argument values
-            std::vector<std::string> values;
-            if (arg->min_nvalues == -1) { // case variadic number of values
-                for (int j = i; j < argc; ++j) { // greedy consume all values until next option argument
-                    std::string value = argv[j];
-                    // check value is an option argument
-                    if (isShortName(value) || isLongName(value)) {
-                        break;
-                    }
-                    // add value
-                    values.push_back(value);
-                }
-            } else { // case ranged number of values
-                for (int j = 0; j < arg->max_nvalues; ++j) {
-                    int index = i + j;
-                    // check index is valid
-                    if (index >= argc) {
-                        break;
-                    }
-                    std::string value = argv[index];
-                    // check value is an option argument
-                    if (isShortName(value) || isLongName(value)) {
-                        break;
+            return arg.default_values;
+        };
+        size_t ndefault_values = 0;
+        for (const auto& list : {&positional_list_, &option_list_}) {
+            for (const auto& arg : *list) {
+                ndefault_values += fallbackValues(*arg).size();
+            }
+        }
+        compiled.default_values.reserve(ndefault_values); // ArgEntry::default_values refer to it, must not reallocate
+        compiled.checks.reserve(arguments_.size()); // ArgEntry::check refers to it
+        std::unordered_map<const Argument*, int> indices; // entry index of each argument
+        if (!commands_.empty()) {
+            compiled.commands = [this](std::string_view prog, std::string_view name, detail::ArgInput& input, Args& args) {
+                auto it = commands_.find(name);
+                if (it == commands_.end()) {
+                    return false;
+                }
+                ArgParser parser = it->second.factory(); // constructed only when used
+                if (parser.program_name_.empty()) {
+                    parser.program_name_ = std::string(prog) + " " + std::string(name);
+                }
+                input.advance(); // skip command name
+                CompiledTable compiled = parser.compile();
+                detail::ArgScanner::scanCommand(name, compiled.table(), input, scan_options_, args);
+                return true;
+            };
+        }
+        compiled.slots.resize(detail::nameTableSize(arguments_.size() + 2)); // + help option
+        for (const auto& name : command_list_) {
+            compiled.command_list.push_back(detail::CommandInfo{name, commands_.find(name)->second.description});
+        }
+        compiled.prog = program_name_;
+        compiled.usage = usage_;
+        compiled.description = description_;
+        compiled.epilog = epilog_;
+        for (const auto& list : {&positional_list_, &option_list_}) {
+            for (const auto& arg : *list) {
+                int index = static_cast<int>(compiled.entries.size());
+                const auto& fallback_values = fallbackValues(*arg);
+                bool from_config = &fallback_values != &arg->default_values;
+                bool flag = arg->min_nvalues == 0 && arg->max_nvalues == 0;
+                // a flag in a config file is set unless its value is "0" or "false"
+                bool flag_set = from_config && flag && !(fallback_values.size() == 1 && (fallback_values[0] == "0" || fallback_values[0] == "false"));
+                size_t ndefault = flag ? 0 : fallback_values.size();
+                const std::string_view* default_values = compiled.default_values.data() + compiled.default_values.size();
+                compiled.default_values.insert(compiled.default_values.end(), fallback_values.begin(), fallback_values.begin() + ndefault);
+                const detail::ValueCheck* check = nullptr;
+                if (!arg->hooks.choices.empty() || arg->hooks.range || arg->hooks.pattern) {
+                    compiled.checks.push_back(detail::ValueCheck{
+                        .choices = detail::ChoiceSet(arg->hooks.choices),
+                        .range = arg->hooks.range,
+                        .pattern = arg->hooks.pattern.get(),
+                        .pattern_source = arg->hooks.pattern_source,
+                    });
+                    check = &compiled.checks.back();
+                }
+                indices.emplace(arg.get(), index);
+                compiled.entries.push_back(detail::ArgEntry{
+                    .position_name = arg->position_name,
+                    .short_name = arg->short_name,
+                    .long_name = arg->long_name,
+                    .description = arg->description,
+                    .usage = arg->usage,
+                    .min_nvalues = arg->min_nvalues,
+                    .max_nvalues = arg->max_nvalues,
+                    .default_values = std::span<const std::string_view>(default_values, ndefault),
+                    .default_parsed = flag_set,
+                    .configured = flag ? flag_set : from_config && !fallback_values.empty(), // a disabled flag is absent
+                    .hooks = &arg->hooks,
+                    .check = check,
+                });
+                if (from_config && !flag) {
+                    detail::checkNValues(compiled.entries.back(), fallback_values.size(), "config key " + arg->hooks.config_key);
+                    for (size_t i = 0; check && i < fallback_values.size(); ++i) {
+                        check->check(fallback_values[i], detail::displayName(compiled.entries.back()));
                     }
-                    // add value
-                    values.push_back(value);
                 }
-                // check number of values is valid
-                if (static_cast<int>(values.size()) < arg->min_nvalues) {
-                    const std::string& arg_name = (is_short_name || is_long_name) ? input_arg : arg->position_name;
-                    throw std::invalid_argument("Not enough values for argument: " + arg_name);
+                if (!arg->position_name.empty()) {
+                    compiled.positionals.push_back(index);
                 }
-            }
-            // set argument values
-            if (is_short_name || is_long_name) { // option argument
-                // option argument can have both short name and long name
-                const std::string& another_name = is_short_name ? arg->long_name : arg->short_name;
-                if (another_name.empty()) { // only short name or long name is set
-                    args.set(input_arg, values);
-                } else { // both short name and long name are set, map both names to the same argument
-                    args.set(arg->short_name, arg->long_name, values);
+                for (const auto* name : {&arg->short_name, &arg->long_name}) {
+                    if (!name->empty()) {
+                        detail::insertName(compiled.slots, *name, index);
+                    }
                 }
-            } else { // positional argument
-                args.set(arg->position_name, values);
             }
-            // skip parsed values
-            i += values.size() - 1; // -1 because i will be incremented in the next loop
         }
-        // check the remaining positional arguments have enough values
-        for (int i = positional_count; i < static_cast<int>(positional_list_.size()); ++i) {
-            const auto& arg = positional_list_[i];
-            if (arg->min_nvalues > 0) { // 0 for optional, -1 for variadic
-                throw std::invalid_argument("Not enough values for argument: " + arg->position_name);
+        // help option, with the names not taken
+        bool help_short_name = arguments_.find("-h") == arguments_.end();
+        bool help_long_name = arguments_.find("--help") == arguments_.end();
+        if (add_help_ && (help_short_name || help_long_name)) {
+            compiled.help_index = static_cast<int>(compiled.entries.size());
+            compiled.entries.push_back(detail::helpEntry(help_short_name, help_long_name));
+            const auto& help = compiled.entries.back();
+            for (std::string_view name : {help.short_name, help.long_name}) {
+                if (!name.empty()) {
+                    detail::insertName(compiled.slots, name, compiled.help_index);
+                }
             }
         }
-        // add default values for positional arguments
-        for (const auto& arg : positional_list_) {
-            // check if the argument has been parsed
-            if (args.has(arg->position_name)) {
-                continue;
+        compiled.long_names.resize(compiled.entries.size());
+        compiled.long_names.resize(detail::sortLongNames(compiled.entries, compiled.long_names));
+        // argument relations as bitsets over entry indices
+        size_t nwords = detail::bitsetWords(compiled.entries.size());
+        auto resolve = [&](const std::string& name) {
+            auto it = arguments_.find(name);
+            if (it == arguments_.end()) {
+                throw std::invalid_argument("Argument not found: " + name);
             }
-            // add default values
-            bool parsed = arg->default_values.empty() ? false : true; // if default values are set, the argument is considered parsed
-            args.set(arg->position_name, arg->default_values, parsed);
-        }
-        // add default values for option arguments
-        for (const auto& arg : option_list_) {
-            // check if the argument has been parsed
-            if (args.has(arg->short_name) || args.has(arg->long_name)) {
-                continue;
+            return static_cast<size_t>(indices.at(it->second.get()));
+        };
+        for (const auto& group : exclusive_groups_) {
+            compiled.exclusive.resize(compiled.exclusive.size() + nwords, 0);
+            for (const auto& name : group) {
+                detail::setBit(std::span(compiled.exclusive).last(nwords), resolve(name));
             }
-            // add default values
-            bool has_short_name = !arg->short_name.empty();
-            bool has_long_name = !arg->long_name.empty();
-            bool parsed = arg->default_values.empty() ? false : true; // if default values are set, the argument is considered parsed
-            if (has_short_name && has_long_name) { // both short name and long name are set
-                args.set(arg->short_name, arg->long_name, arg->default_values, parsed);
-            } else { // only short name or long name is set
-                auto& name = has_short_name ? arg->short_name : arg->long_name;
-                args.set(name, arg->default_values, parsed);
+        }
+        for (const auto& list : {&positional_list_, &option_list_}) {
+            for (const auto& arg : *list) {
+                int index = indices.at(arg.get());
+                if (arg->required) {
+                    compiled.required.resize(nwords, 0);
+                    detail::setBit(compiled.required, index);
+                }
+                if (!arg->dependencies.empty()) {
+                    compiled.dependents.push_back(index);
+                    compiled.dependencies.resize(compiled.dependencies.size() + nwords, 0);
+                    for (const auto& name : arg->dependencies) {
+                        detail::setBit(std::span(compiled.dependencies).last(nwords), resolve(name));
+                    }
+                }
             }
         }
-        return args;
+        return compiled;
     }
 
 private:
@@ -446,9 +2526,66 @@ private:
     std::string usage_; // auto generated if empty
     std::string description_;
     std::string epilog_;
-    std::unordered_map<std::string, std::shared_ptr<Argument>> arguments_;
+    bool add_help_ = false;
+    detail::ScanOptions scan_options_;
+    std::unordered_map<std::string, std::shared_ptr<Argument>, detail::StringHash, std::equal_to<>> arguments_;
+    std::unordered_map<std::string, std::vector<std::string>> config_; // config file key -> values
+    std::unordered_map<std::string, Command, detail::StringHash, std::equal_to<>> commands_; // subcommand name -> parser factory
+    std::vector<std::string> command_list_; // subcommand names in registration order
+    std::vector<std::vector<std::string>> exclusive_groups_; // argument names of each mutually exclusive group
+    std::shared_ptr<uint64_t> revision_ = std::make_shared<uint64_t>(0); // incremented on every change, shared with ArgumentSetter
+    mutable detail::HelpCache help_cache_; // help message of the current revision
+    mutable uint64_t help_revision_ = UINT64_MAX;
+    mutable std::shared_ptr<const std::string> help_; // message returned by help()
     std::vector<std::shared_ptr<Argument>> positional_list_;
     std::vector<std::shared_ptr<Argument>> option_list_;
 };
 
+/**
+ * @brief Immutable compiled ArgParser, see ArgParser::freeze.
+ *
+ * parse() is const and reentrant, so a frozen parser can be shared between threads and used for every request.
+ * The argument table is compiled once, and the scan buffers are thread-local and reused between calls.
+ *
+ * @note Subcommand parsers are still built by their factories on each use, the factories must be thread-safe.
+ * @note Bound variables (ArgumentSetter::bind) are written by every parse.
+ */
+class FrozenArgParser {
+    friend class ArgParser;
+
+public:
+    FrozenArgParser(const FrozenArgParser&) = delete;
+    FrozenArgParser& operator=(const FrozenArgParser&) = delete;
+
+    /**
+     * @brief Parse argv, never prints or exits.
+     *
+     * @throw HelpRequested if the help option is given, even if the parser was frozen with exitOnHelp().
+     */
+    Args parse(int argc, char* argv[]) const {
+        return detail::ArgScanner::parse(compiled_.table(), argc, argv, parser_.scan_options_);
+    }
+
+    /**
+     * @brief Help message, rendered once per terminal width and cached, the help option throws the same message.
+     */
+    std::string help() const {
+        return *detail::renderHelp(compiled_.table());
+    }
+
+private:
+    explicit FrozenArgParser(ArgParser parser) : parser_(std::move(parser)), compiled_(parser_.compile()) {
+        parser_.scan_options_.exit_on_help = false; // shared by callers that cannot have the process exit under them
+    }
+
+private:
+    ArgParser parser_; // owns the arguments viewed by compiled_
+    ArgParser::CompiledTable compiled_;
+};
+
+inline std::shared_ptr<const FrozenArgParser> ArgParser::freeze() const {
+    // not movable, the compiled table points into parser_
+    return std::shared_ptr<const FrozenArgParser>(new FrozenArgParser(clone()));
+}
+
 }
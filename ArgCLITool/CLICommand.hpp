@@ -0,0 +1,490 @@
+#pragma once
+
+#include "ArgParser.hpp"
+#include "CLIParser.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <stdexcept>
+
+namespace ArgCLITool {
+
+namespace detail {
+
+static inline std::string argumentTypeName(Argument::Type type) {
+    switch (type) {
+        case Argument::Type::Identifier:    return "identifier";
+        case Argument::Type::String:        return "string";
+        case Argument::Type::Integer:       return "integer";
+        case Argument::Type::Float:         return "float";
+        case Argument::Type::IntegerVector: return "integer vector";
+        case Argument::Type::FloatVector:   return "float vector";
+    }
+    return "unknown";
+}
+
+/**
+ * @brief Convert value to type in place, returns false if it cannot be converted.
+ *
+ * @note Identifiers convert to strings, integers to floats, numbers to vectors of one number and integer vectors
+ * @note to float vectors. Nothing is narrowed.
+ */
+static inline bool normalizeArgument(Argument& value, Argument::Type type) {
+    using Type = Argument::Type;
+    if (value.type == type) {
+        return true;
+    }
+    switch (type) {
+        case Type::String:
+            if (value.type == Type::Identifier) {
+                value.type = Type::String;
+                return true;
+            }
+            return false;
+        case Type::Float:
+            if (value.type == Type::Integer) {
+                value = Argument{Type::Float, FloatData(static_cast<double>(std::get<IntegerData>(value.data).value))};
+                return true;
+            }
+            return false;
+        case Type::IntegerVector:
+            if (value.type == Type::Integer) {
+                value = Argument{Type::IntegerVector, IntegerVectorData({std::get<IntegerData>(value.data).value})};
+                return true;
+            }
+            return false;
+        case Type::FloatVector:
+            if (value.type == Type::Integer || value.type == Type::Float) {
+                double number = value.type == Type::Integer ? static_cast<double>(std::get<IntegerData>(value.data).value)
+                                                            : std::get<FloatData>(value.data).value;
+                value = Argument{Type::FloatVector, FloatVectorData({number})};
+                return true;
+            }
+            if (value.type == Type::IntegerVector) {
+                const auto& integers = std::get<IntegerVectorData>(value.data).value;
+                value = Argument{Type::FloatVector, FloatVectorData(std::vector<double>(integers.begin(), integers.end()))};
+                return true;
+            }
+            return false;
+        default:
+            return false;
+    }
+}
+
+}
+
+/**
+ * @brief Validated arguments of an interactive command, see CommandSchema::validate.
+ *
+ * Arguments are accessed by the names declared in the schema, the values already have the declared types.
+ */
+class CommandArgs {
+    friend class CommandSchema;
+
+public:
+    inline const std::string& name() const {
+        return name_;
+    }
+
+    // true if the argument was given or has default values
+    inline bool has(std::string_view name) const {
+        return !values(name).empty();
+    }
+
+    inline std::span<const Argument> values(std::string_view name) const {
+        const auto& range = find(name);
+        return std::span<const Argument>(values_.data() + range.begin, range.count);
+    }
+
+    /**
+     * @brief Value of the argument converted to T.
+     *
+     * @tparam T std::string, an integral or floating point type, std::vector<int64_t> or std::vector<double>.
+     */
+    template <typename T>
+    inline T as(std::string_view name, size_t index = 0) const {
+        auto arg_values = values(name);
+        if (index >= arg_values.size()) {
+            throw std::out_of_range("Index " + std::to_string(index) + " out of range for argument: " + std::string(name));
+        }
+        const Argument& value = arg_values[index];
+        if constexpr (std::is_same_v<T, std::string>) {
+            if (const auto* data = std::get_if<StringData>(&value.data)) {
+                return data->value;
+            }
+        } else if constexpr (std::is_same_v<T, std::vector<int64_t>>) {
+            if (const auto* data = std::get_if<IntegerVectorData>(&value.data)) {
+                return data->value;
+            }
+        } else if constexpr (std::is_same_v<T, std::vector<double>>) {
+            if (const auto* data = std::get_if<FloatVectorData>(&value.data)) {
+                return data->value;
+            }
+        } else if constexpr (std::is_integral_v<T>) {
+            if (const auto* data = std::get_if<IntegerData>(&value.data)) {
+                return static_cast<T>(data->value);
+            }
+        } else if constexpr (std::is_floating_point_v<T>) {
+            if (const auto* data = std::get_if<FloatData>(&value.data)) {
+                return static_cast<T>(data->value);
+            }
+            if (const auto* data = std::get_if<IntegerData>(&value.data)) {
+                return static_cast<T>(data->value);
+            }
+        }
+        throw std::invalid_argument("Invalid type of " + detail::argumentTypeName(value.type) + " argument: " + std::string(name));
+    }
+
+private:
+    struct Range {
+        std::string name;
+        size_t begin;
+        size_t count;
+    };
+
+    const Range& find(std::string_view name) const {
+        for (const auto& range : ranges_) {
+            if (range.name == name) {
+                return range;
+            }
+        }
+        throw std::invalid_argument("Argument not found: " + std::string(name));
+    }
+
+private:
+    std::string name_;
+    std::vector<Argument> values_; // values of all arguments, in declaration order
+    std::vector<Range> ranges_;    // values of each argument in values_, in declaration order
+};
+
+/**
+ * @brief Arguments of an interactive command, declared like the positional arguments of ArgParser.
+ *
+ * A Command from CLIParser is validated once against the schema, assigning its arguments to the declared names,
+ * checking their number and types, and filling in default values.
+ */
+class CommandSchema {
+public:
+    struct ArgumentSpec {
+        std::string name;
+        std::string description;
+        std::string usage;
+        int min_nvalues;                      // minimum number of values, -1 for variadic
+        int max_nvalues;                      // maximum number of values
+        std::vector<Argument::Type> types;    // accepted types, any type if empty
+        std::vector<Argument> default_values; // used when no value is given
+    };
+
+    // Same vocabulary as ArgParser::ArgumentSetter
+    class ArgumentSetter {
+    public:
+        ArgumentSetter(std::weak_ptr<ArgumentSpec> arg) : arg_(arg) {}
+
+        ArgumentSetter& description(const std::string& description) {
+            get()->description = description;
+            return *this;
+        }
+
+        ArgumentSetter& usage(const std::string& usage) {
+            get()->usage = usage;
+            return *this;
+        }
+
+        /**
+         * @brief Set the number of values for the argument, same rules as ArgParser::ArgumentSetter::nvalues.
+         */
+        ArgumentSetter& nvalues(int min, int max = -1) {
+            detail::normalizeNValues(true, min, max);
+            auto arg = get();
+            arg->min_nvalues = min;
+            arg->max_nvalues = max;
+            return *this;
+        }
+
+        /**
+         * @brief Accept values of the given types only, values of other types are converted when possible.
+         *
+         * @note Identifiers convert to strings, integers to floats, numbers to vectors and integer vectors to float vectors.
+         */
+        ArgumentSetter& type(std::initializer_list<Argument::Type> types) {
+            get()->types = types;
+            return *this;
+        }
+
+        ArgumentSetter& type(Argument::Type type) {
+            return this->type({type});
+        }
+
+        /**
+         * @brief Set the default values for the argument, written in the command syntax (for example "1.5", "\"text\"").
+         */
+        ArgumentSetter& defaultValues(const std::vector<std::string>& default_values) {
+            std::string source = "default";
+            for (const auto& value : default_values) {
+                source += " " + value;
+            }
+            source += "\n";
+            CLIStringInputStream stream(source);
+            CLIParser parser(stream);
+            get()->default_values = parser.parseCommand().arguments;
+            return *this;
+        }
+
+    private:
+        std::shared_ptr<ArgumentSpec> get() const {
+            auto arg = arg_.lock();
+            if (!arg) {
+                throw std::invalid_argument("Argument has been deleted");
+            }
+            return arg;
+        }
+
+    private:
+        std::weak_ptr<ArgumentSpec> arg_;
+    };
+
+public:
+    explicit CommandSchema(const std::string& name) : name_(name) {
+        if (!detail::isPositional(name)) {
+            throw std::invalid_argument("Invalid command name: " + name);
+        }
+    }
+
+    inline const std::string& name() const {
+        return name_;
+    }
+
+    CommandSchema& description(const std::string& description) {
+        description_ = description;
+        return *this;
+    }
+
+    inline const std::string& description() const {
+        return description_;
+    }
+
+    inline std::span<const std::shared_ptr<ArgumentSpec>> arguments() const {
+        return arguments_;
+    }
+
+    /**
+     * @brief Add an argument, takes one value by default.
+     */
+    ArgumentSetter add(const std::string& name) {
+        if (!detail::isPositional(name)) {
+            throw std::invalid_argument("Invalid argument name: " + name);
+        }
+        for (const auto& arg : arguments_) {
+            if (arg->name == name) {
+                throw std::invalid_argument("Duplicate argument name: " + name);
+            }
+        }
+        auto spec = std::make_shared<ArgumentSpec>();
+        spec->name = name;
+        spec->min_nvalues = 1;
+        spec->max_nvalues = 1;
+        arguments_.push_back(std::move(spec));
+        return ArgumentSetter(arguments_.back());
+    }
+
+    /**
+     * @brief Assign the arguments of command to the declared arguments.
+     *
+     * @note Each argument takes as many values as it can while leaving enough for the required arguments after it.
+     * @throw std::invalid_argument if the command does not match the schema.
+     */
+    CommandArgs validate(Command command) const {
+        if (command.name != name_) {
+            throw std::invalid_argument("Command " + command.name + " does not match schema: " + name_);
+        }
+        // values required by the arguments after each argument
+        std::vector<size_t> required_after(arguments_.size() + 1, 0);
+        for (size_t i = arguments_.size(); i-- > 0;) {
+            required_after[i] = required_after[i + 1] + static_cast<size_t>(std::max(arguments_[i]->min_nvalues, 0));
+        }
+        CommandArgs args;
+        args.name_ = std::move(command.name);
+        args.values_.reserve(command.arguments.size());
+        args.ranges_.reserve(arguments_.size());
+        auto& values = command.arguments;
+        size_t position = 0;
+        for (size_t i = 0; i < arguments_.size(); ++i) {
+            const ArgumentSpec& arg = *arguments_[i];
+            size_t remaining = values.size() - position;
+            size_t available = remaining > required_after[i + 1] ? remaining - required_after[i + 1] : 0;
+            size_t max_nvalues = arg.min_nvalues == -1 ? SIZE_MAX : static_cast<size_t>(arg.max_nvalues);
+            size_t count = std::min(available, max_nvalues);
+            if (static_cast<int>(count) < arg.min_nvalues) {
+                throw std::invalid_argument("Not enough values for argument " + arg.name + " of command: " + name_);
+            }
+            size_t begin = args.values_.size();
+            if (count == 0) {
+                args.values_.insert(args.values_.end(), arg.default_values.begin(), arg.default_values.end());
+            } else {
+                for (size_t j = position; j < position + count; ++j) {
+                    args.values_.push_back(std::move(values[j]));
+                }
+                position += count;
+            }
+            for (size_t j = begin; j < args.values_.size(); ++j) {
+                checkType(arg, args.values_[j]);
+            }
+            args.ranges_.push_back(CommandArgs::Range{arg.name, begin, args.values_.size() - begin});
+        }
+        if (position < values.size()) {
+            throw std::invalid_argument("Too many arguments for command: " + name_);
+        }
+        return args;
+    }
+
+private:
+    void checkType(const ArgumentSpec& arg, Argument& value) const {
+        if (arg.types.empty()) {
+            return;
+        }
+        for (auto type : arg.types) {
+            if (value.type == type) {
+                return;
+            }
+        }
+        for (auto type : arg.types) {
+            if (detail::normalizeArgument(value, type)) {
+                return;
+            }
+        }
+        std::string expected;
+        for (auto type : arg.types) {
+            expected += (expected.empty() ? "" : " or ") + detail::argumentTypeName(type);
+        }
+        throw std::invalid_argument("Invalid " + detail::argumentTypeName(value.type) + " value for argument " + arg.name +
+                                    " of command " + name_ + ", expected " + expected);
+    }
+
+private:
+    std::string name_;
+    std::string description_;
+    std::vector<std::shared_ptr<ArgumentSpec>> arguments_;
+};
+
+/**
+ * @brief Registry of interactive commands, validates each parsed Command against its schema and calls its handler.
+ *
+ * @code
+ * ArgCLITool::CLIDispatcher dispatcher;
+ * auto& move = dispatcher.add("move", [](const ArgCLITool::CommandArgs& args) {
+ *     auto position = args.as<std::vector<double>>("position");
+ * });
+ * move.add("position").type(ArgCLITool::Argument::Type::FloatVector);
+ * dispatcher.run(std::cin);
+ * @endcode
+ */
+class CLIDispatcher {
+public:
+    using Handler = std::function<void(const CommandArgs& args)>;
+    using Observer = std::function<void(const Command& command)>;
+
+public:
+    /**
+     * @brief Register a command, returns its schema to declare the arguments.
+     */
+    CommandSchema& add(const std::string& name, Handler handler) {
+        if (commands_.find(name) != commands_.end()) {
+            throw std::invalid_argument("Duplicate command name: " + name);
+        }
+        auto& entry = commands_.emplace(name, Entry{CommandSchema(name), std::move(handler)}).first->second;
+        command_list_.push_back(name);
+        return entry.schema;
+    }
+
+    // schema of the command name, null if not registered
+    const CommandSchema* find(std::string_view name) const {
+        auto it = commands_.find(name);
+        return it == commands_.end() ? nullptr : &it->second.schema;
+    }
+
+    // registered command names, in registration order
+    inline std::span<const std::string> commands() const {
+        return command_list_;
+    }
+
+    /**
+     * @brief Validate command against its schema.
+     *
+     * @throw std::invalid_argument if the command is not registered or does not match its schema.
+     */
+    CommandArgs validate(Command command) const {
+        return entry(command.name).schema.validate(std::move(command));
+    }
+
+    /**
+     * @brief Call observer with each command whose handler returned, for example to journal the commands.
+     *
+     * @note The command is copied for the observer, without observer it is moved into validation.
+     */
+    inline void onDispatch(Observer observer) {
+        observer_ = std::move(observer);
+    }
+
+    /**
+     * @brief Validate command and call its handler.
+     */
+    void dispatch(Command command) const {
+        const Entry& command_entry = entry(command.name);
+        if (!observer_) {
+            command_entry.handler(command_entry.schema.validate(std::move(command)));
+            return;
+        }
+        command_entry.handler(command_entry.schema.validate(command));
+        observer_(command);
+    }
+
+    /**
+     * @brief Parse and dispatch the commands of stream until the end of the stream.
+     */
+    void run(CLIInputStream& stream) const {
+        CLIParser parser(stream);
+        while (parser.hasMoreCommands()) {
+            Command command = parser.parseCommand();
+            if (!command.name.empty()) {
+                dispatch(std::move(command));
+            }
+        }
+    }
+
+    void run(std::istream& stream) const {
+        CLIStdInputStream input(stream);
+        run(input);
+    }
+
+private:
+    struct Entry {
+        CommandSchema schema;
+        Handler handler;
+    };
+
+    const Entry& entry(std::string_view name) const {
+        auto it = commands_.find(name);
+        if (it == commands_.end()) {
+            detail::ClosestName closest(name);
+            for (const auto& command : command_list_) {
+                closest.consider(command);
+            }
+            throw std::invalid_argument("Unknown command: " + std::string(name) + closest.suggestion());
+        }
+        return it->second;
+    }
+
+private:
+    std::unordered_map<std::string, Entry, detail::StringHash, std::equal_to<>> commands_;
+    std::vector<std::string> command_list_;
+    Observer observer_;
+};
+
+}
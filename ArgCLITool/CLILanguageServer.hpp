@@ -0,0 +1,838 @@
+#pragma once
+
+#include "CLICommand.hpp"
+#include "ScriptIndex.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace ArgCLITool {
+
+namespace detail {
+
+// JSON value of the messages of CLILanguageServer
+class Json {
+public:
+    using Array = std::vector<Json>;
+    using Object = std::vector<std::pair<std::string, Json>>; // members in order, looked up linearly
+
+public:
+    Json() = default;
+    Json(std::nullptr_t) {}
+    Json(bool value) : value_(value) {}
+
+    template <typename T>
+        requires(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>)
+    Json(T value) : value_(static_cast<double>(value)) {}
+
+    Json(std::string value) : value_(std::move(value)) {}
+    Json(std::string_view value) : value_(std::string(value)) {}
+    Json(const char* value) : value_(std::string(value)) {}
+    Json(Array value) : value_(std::move(value)) {}
+    Json(Object value) : value_(std::move(value)) {}
+
+    inline bool isNull() const {
+        return std::holds_alternative<std::nullptr_t>(value_);
+    }
+
+    inline bool isString() const {
+        return std::holds_alternative<std::string>(value_);
+    }
+
+    inline bool isNumber() const {
+        return std::holds_alternative<double>(value_);
+    }
+
+    // member key, null if this is not an object or has no such member
+    const Json& operator[](std::string_view key) const {
+        if (const auto* object = std::get_if<Object>(&value_)) {
+            for (const auto& [name, value] : *object) {
+                if (name == key) {
+                    return value;
+                }
+            }
+        }
+        static const Json null;
+        return null;
+    }
+
+    // elements, empty if this is not an array
+    std::span<const Json> items() const {
+        const auto* array = std::get_if<Array>(&value_);
+        return array ? std::span<const Json>(*array) : std::span<const Json>();
+    }
+
+    // empty if this is not a string
+    std::string_view string() const {
+        const auto* string = std::get_if<std::string>(&value_);
+        return string ? std::string_view(*string) : std::string_view();
+    }
+
+    double number(double fallback = 0.0) const {
+        const auto* number = std::get_if<double>(&value_);
+        return number ? *number : fallback;
+    }
+
+    /**
+     * @brief Parse text as a single JSON value.
+     *
+     * @throw std::invalid_argument if text is not valid JSON.
+     */
+    static Json parse(std::string_view text) {
+        Parser parser{text};
+        parser.skipSpace();
+        Json value = parser.parseValue(0);
+        parser.skipSpace();
+        if (parser.position != text.size()) {
+            parser.fail();
+        }
+        return value;
+    }
+
+    std::string dump() const {
+        std::string out;
+        write(out);
+        return out;
+    }
+
+    void write(std::string& out) const {
+        switch (value_.index()) {
+            case 0:
+                out += "null";
+                break;
+            case 1:
+                out += std::get<bool>(value_) ? "true" : "false";
+                break;
+            case 2:
+                writeNumber(out, std::get<double>(value_));
+                break;
+            case 3:
+                writeString(out, std::get<std::string>(value_));
+                break;
+            case 4: {
+                out += '[';
+                const auto& array = std::get<Array>(value_);
+                for (size_t i = 0; i < array.size(); ++i) {
+                    if (i > 0) {
+                        out += ',';
+                    }
+                    array[i].write(out);
+                }
+                out += ']';
+                break;
+            }
+            case 5: {
+                out += '{';
+                const auto& object = std::get<Object>(value_);
+                for (size_t i = 0; i < object.size(); ++i) {
+                    if (i > 0) {
+                        out += ',';
+                    }
+                    writeString(out, object[i].first);
+                    out += ':';
+                    object[i].second.write(out);
+                }
+                out += '}';
+                break;
+            }
+        }
+    }
+
+private:
+    struct Parser {
+        static constexpr int kMaxDepth = 256;
+
+        std::string_view text;
+        size_t position = 0;
+
+        [[noreturn]] void fail() const {
+            throw std::invalid_argument("Invalid JSON at position " + std::to_string(position));
+        }
+
+        void skipSpace() {
+            while (position < text.size() && (text[position] == ' ' || text[position] == '\t' ||
+                                              text[position] == '\n' || text[position] == '\r')) {
+                ++position;
+            }
+        }
+
+        void expect(std::string_view literal) {
+            if (text.substr(position, literal.size()) != literal) {
+                fail();
+            }
+            position += literal.size();
+        }
+
+        Json parseValue(int depth) {
+            if (position >= text.size() || depth > kMaxDepth) {
+                fail();
+            }
+            switch (text[position]) {
+                case 'n':
+                    expect("null");
+                    return Json();
+                case 't':
+                    expect("true");
+                    return Json(true);
+                case 'f':
+                    expect("false");
+                    return Json(false);
+                case '"':
+                    return Json(parseString());
+                case '[': {
+                    ++position;
+                    Array array;
+                    skipSpace();
+                    if (position < text.size() && text[position] == ']') {
+                        ++position;
+                        return Json(std::move(array));
+                    }
+                    while (true) {
+                        skipSpace();
+                        array.push_back(parseValue(depth + 1));
+                        skipSpace();
+                        if (position < text.size() && text[position] == ',') {
+                            ++position;
+                        } else {
+                            expect("]");
+                            return Json(std::move(array));
+                        }
+                    }
+                }
+                case '{': {
+                    ++position;
+                    Object object;
+                    skipSpace();
+                    if (position < text.size() && text[position] == '}') {
+                        ++position;
+                        return Json(std::move(object));
+                    }
+                    while (true) {
+                        skipSpace();
+                        if (position >= text.size() || text[position] != '"') {
+                            fail();
+                        }
+                        std::string name = parseString();
+                        skipSpace();
+                        expect(":");
+                        skipSpace();
+                        object.emplace_back(std::move(name), parseValue(depth + 1));
+                        skipSpace();
+                        if (position < text.size() && text[position] == ',') {
+                            ++position;
+                        } else {
+                            expect("}");
+                            return Json(std::move(object));
+                        }
+                    }
+                }
+                default:
+                    return Json(parseNumber());
+            }
+        }
+
+        double parseNumber() {
+            size_t begin = position;
+            while (position < text.size() && (std::string_view("+-.eE").find(text[position]) != std::string_view::npos ||
+                                              (text[position] >= '0' && text[position] <= '9'))) {
+                ++position;
+            }
+            double value = 0.0;
+            auto [end, error] = std::from_chars(text.data() + begin, text.data() + position, value);
+            if (begin == position || error != std::errc() || end != text.data() + position) {
+                position = begin;
+                fail();
+            }
+            return value;
+        }
+
+        uint32_t parseHex4() {
+            if (text.size() - position < 4) {
+                fail();
+            }
+            uint32_t value = 0;
+            auto [end, error] = std::from_chars(text.data() + position, text.data() + position + 4, value, 16);
+            if (error != std::errc() || end != text.data() + position + 4) {
+                fail();
+            }
+            position += 4;
+            return value;
+        }
+
+        std::string parseString() {
+            ++position; // opening quote
+            std::string value;
+            while (true) {
+                size_t plain = text.find_first_of("\"\\", position);
+                if (plain == std::string_view::npos) {
+                    position = text.size();
+                    fail();
+                }
+                value.append(text.substr(position, plain - position));
+                position = plain + 1;
+                if (text[plain] == '"') {
+                    return value;
+                }
+                if (position >= text.size()) {
+                    fail();
+                }
+                char escape = text[position++];
+                switch (escape) {
+                    case '"': value += '"'; break;
+                    case '\\': value += '\\'; break;
+                    case '/': value += '/'; break;
+                    case 'b': value += '\b'; break;
+                    case 'f': value += '\f'; break;
+                    case 'n': value += '\n'; break;
+                    case 'r': value += '\r'; break;
+                    case 't': value += '\t'; break;
+                    case 'u': {
+                        uint32_t code = parseHex4();
+                        if (code >= 0xD800 && code < 0xDC00 && text.substr(position, 2) == "\\u") { // surrogate pair
+                            position += 2;
+                            uint32_t low = parseHex4();
+                            if (low < 0xDC00 || low >= 0xE000) {
+                                fail();
+                            }
+                            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        }
+                        appendUtf8(value, code);
+                        break;
+                    }
+                    default:
+                        --position;
+                        fail();
+                }
+            }
+        }
+
+        static void appendUtf8(std::string& out, uint32_t code) {
+            if (code < 0x80) {
+                out += static_cast<char>(code);
+            } else if (code < 0x800) {
+                out += static_cast<char>(0xC0 | (code >> 6));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            } else if (code < 0x10000) {
+                out += static_cast<char>(0xE0 | (code >> 12));
+                out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            } else {
+                out += static_cast<char>(0xF0 | (code >> 18));
+                out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+                out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            }
+        }
+    };
+
+    static void writeNumber(std::string& out, double value) {
+        if (!std::isfinite(value)) {
+            out += "null";
+            return;
+        }
+        char buffer[32];
+        std::to_chars_result result;
+        if (value == std::trunc(value) && std::fabs(value) < 1e15) { // integers, such as ids and positions
+            result = std::to_chars(buffer, buffer + sizeof(buffer), static_cast<int64_t>(value));
+        } else {
+            result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        }
+        out.append(buffer, result.ptr);
+    }
+
+    static void writeString(std::string& out, std::string_view value) {
+        constexpr const char* kHex = "0123456789abcdef";
+        out += '"';
+        for (char c : value) {
+            switch (c) {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        out += "\\u00";
+                        out += kHex[(c >> 4) & 0xF];
+                        out += kHex[c & 0xF];
+                    } else {
+                        out += c;
+                    }
+            }
+        }
+        out += '"';
+    }
+
+private:
+    std::variant<std::nullptr_t, bool, double, std::string, Array, Object> value_;
+};
+
+// Offsets of the line starts of a text, kept up to date with the edits of the text
+class LineTable {
+public:
+    explicit LineTable(std::string_view text = {}) {
+        reset(text);
+    }
+
+    void reset(std::string_view text) {
+        starts_.assign(1, 0);
+        appendStarts(starts_, text, 0);
+    }
+
+    // update after [offset, offset + removed) of the text is replaced by inserted
+    void edit(size_t offset, size_t removed, std::string_view inserted) {
+        // the lines starting after a removed new line are replaced by the lines of inserted
+        auto first = std::upper_bound(starts_.begin(), starts_.end(), offset);
+        auto last = std::upper_bound(first, starts_.end(), offset + removed);
+        std::vector<size_t> added;
+        appendStarts(added, inserted, offset);
+        size_t index = static_cast<size_t>(first - starts_.begin());
+        first = starts_.insert(starts_.erase(first, last), added.begin(), added.end());
+        int64_t delta = static_cast<int64_t>(inserted.size()) - static_cast<int64_t>(removed);
+        for (auto it = starts_.begin() + static_cast<std::ptrdiff_t>(index + added.size()); it != starts_.end(); ++it) {
+            *it = static_cast<size_t>(static_cast<int64_t>(*it) + delta);
+        }
+    }
+
+    inline size_t lineCount() const {
+        return starts_.size();
+    }
+
+    inline size_t lineBegin(size_t line) const {
+        return starts_[line];
+    }
+
+    // line of offset, starting at 0
+    size_t line(size_t offset) const {
+        return static_cast<size_t>(std::upper_bound(starts_.begin(), starts_.end(), offset) - starts_.begin()) - 1;
+    }
+
+private:
+    static void appendStarts(std::vector<size_t>& starts, std::string_view text, size_t base) {
+        for (size_t newline = text.find('\n'); newline != std::string_view::npos; newline = text.find('\n', newline + 1)) {
+            starts.push_back(base + newline + 1);
+        }
+    }
+
+private:
+    std::vector<size_t> starts_;
+};
+
+static inline bool isIdentifierChar(char c) {
+    return isAlpha(c) || (c >= '0' && c <= '9') || c == '_';
+}
+
+// Usage of command, for example "move POSITION [SPEED] [FILES ...]"
+static inline std::string commandSignature(const CommandSchema& schema) {
+    std::string signature = schema.name();
+    for (const auto& arg : schema.arguments()) {
+        std::string name = !arg->usage.empty() ? arg->usage : arg->name;
+        int required = std::max(arg->min_nvalues, 0);
+        for (int i = 0; i < required; ++i) {
+            signature += " " + name;
+        }
+        if (arg->min_nvalues == -1 || arg->max_nvalues - required > 1) {
+            signature += " [" + name + " ...]";
+        } else if (arg->max_nvalues > required) {
+            signature += " [" + name + "]";
+        }
+    }
+    return signature;
+}
+
+}
+
+/**
+ * @brief Language server for scripts of the commands of a CLIDispatcher, speaking the Language Server Protocol
+ * over stdin and stdout.
+ *
+ * Provides diagnostics for parse errors and commands that do not match their schema, completion of the command
+ * names and hover with the signature and description of a command. Documents are synchronized incrementally:
+ * each change re-parses and re-validates only the commands around it (see ScriptIndex), so diagnostics follow
+ * typing in large scripts.
+ *
+ * @note Positions are in UTF-8 code units when the client supports them, UTF-16 code units otherwise.
+ *
+ * @code
+ * ArgCLITool::CLIDispatcher dispatcher;
+ * dispatcher.add("move", handler).description("Move to a position").add("position");
+ * return ArgCLITool::CLILanguageServer(dispatcher).run();
+ * @endcode
+ */
+class CLILanguageServer {
+public:
+    using Json = detail::Json;
+
+public:
+    explicit CLILanguageServer(const CLIDispatcher& dispatcher, std::istream& in = std::cin, std::ostream& out = std::cout)
+        : dispatcher_(dispatcher), in_(in), out_(out) {}
+
+    /**
+     * @brief Serve requests until the exit notification or the end of the input.
+     *
+     * @return int The exit code of the server process: 0 after a shutdown request, 1 otherwise.
+     */
+    int run() {
+        std::string body;
+        while (readMessage(body)) {
+            Json message;
+            try {
+                message = Json::parse(body);
+            } catch (const std::invalid_argument& e) {
+                sendError(Json(), kParseError, e.what());
+                continue;
+            }
+            if (message["method"].string() == "exit") {
+                return shutdown_ ? 0 : 1;
+            }
+            handle(message);
+        }
+        return 1;
+    }
+
+private:
+    static constexpr int kParseError = -32700;
+    static constexpr int kInvalidRequest = -32600;
+    static constexpr int kMethodNotFound = -32601;
+    static constexpr int kInvalidParams = -32602;
+
+    struct Document {
+        ScriptIndex index;
+        detail::LineTable lines;
+        std::vector<std::string> errors; // validation error of each command of index, empty if valid
+    };
+
+    void handle(const Json& message) {
+        std::string_view method = message["method"].string();
+        const Json& id = message["id"];
+        const Json& params = message["params"];
+        bool request = !id.isNull();
+        try {
+            if (method == "initialize") {
+                reply(id, initialize(params));
+            } else if (method == "shutdown") {
+                shutdown_ = true;
+                reply(id, Json());
+            } else if (method == "textDocument/didOpen") {
+                open(params["textDocument"]);
+            } else if (method == "textDocument/didChange") {
+                change(params["textDocument"]["uri"].string(), params["contentChanges"]);
+            } else if (method == "textDocument/didClose") {
+                close(params["textDocument"]["uri"].string());
+            } else if (method == "textDocument/completion") {
+                reply(id, completion(document(params), params["position"]));
+            } else if (method == "textDocument/hover") {
+                reply(id, hover(document(params), params["position"]));
+            } else if (request) {
+                sendError(id, method.empty() ? kInvalidRequest : kMethodNotFound, "Unsupported method: " + std::string(method));
+            }
+            // other notifications, such as initialized and $/cancelRequest, need no action
+        } catch (const std::exception& e) {
+            if (request) {
+                sendError(id, kInvalidParams, e.what());
+            }
+        }
+    }
+
+    Json initialize(const Json& params) {
+        // prefer UTF-8 positions, the offsets of the script
+        utf8_positions_ = false;
+        for (const auto& encoding : params["capabilities"]["general"]["positionEncodings"].items()) {
+            utf8_positions_ = utf8_positions_ || encoding.string() == "utf-8";
+        }
+        return Json::Object{
+            {"capabilities", Json::Object{
+                {"positionEncoding", utf8_positions_ ? "utf-8" : "utf-16"},
+                {"textDocumentSync", Json::Object{{"openClose", true}, {"change", 2}}}, // incremental
+                {"completionProvider", Json::Object{}},
+                {"hoverProvider", true},
+            }},
+            {"serverInfo", Json::Object{{"name", "ArgCLITool"}}},
+        };
+    }
+
+    void open(const Json& item) {
+        std::string uri(item["uri"].string());
+        Document& doc = documents_[uri];
+        doc.index = ScriptIndex(std::string(item["text"].string()));
+        doc.lines.reset(doc.index.source());
+        doc.errors.clear();
+        validate(doc, ScriptUpdate{0, 0, doc.index.commands().size()});
+        publishDiagnostics(uri, doc);
+    }
+
+    void change(std::string_view uri, const Json& changes) {
+        auto it = documents_.find(std::string(uri));
+        if (it == documents_.end()) {
+            return;
+        }
+        Document& doc = it->second;
+        for (const auto& change : changes.items()) {
+            std::string_view text = change["text"].string();
+            const Json& range = change["range"];
+            if (range.isNull()) { // the whole document
+                ScriptUpdate update = doc.index.update(std::string(text));
+                doc.lines.reset(doc.index.source());
+                validate(doc, update);
+                continue;
+            }
+            size_t begin = offset(doc, range["start"]);
+            size_t end = std::max(begin, offset(doc, range["end"]));
+            ScriptUpdate update = doc.index.edit(begin, end - begin, text);
+            doc.lines.edit(begin, end - begin, text);
+            validate(doc, update);
+        }
+        publishDiagnostics(it->first, doc);
+    }
+
+    void close(std::string_view uri) {
+        if (documents_.erase(std::string(uri)) > 0) {
+            send(notification("textDocument/publishDiagnostics",
+                              Json::Object{{"uri", uri}, {"diagnostics", Json::Array{}}}));
+        }
+    }
+
+    const Document& document(const Json& params) const {
+        auto it = documents_.find(std::string(params["textDocument"]["uri"].string()));
+        if (it == documents_.end()) {
+            throw std::invalid_argument("Unknown document: " + std::string(params["textDocument"]["uri"].string()));
+        }
+        return it->second;
+    }
+
+    // validate the commands replaced by update, the errors of the other commands are kept
+    void validate(Document& doc, const ScriptUpdate& update) {
+        std::vector<std::string> errors(update.inserted);
+        for (size_t i = 0; i < update.inserted; ++i) {
+            const ScriptCommand& command = doc.index.commands()[update.first + i];
+            if (!command.error.empty()) {
+                continue; // parse error, reported from the index
+            }
+            try {
+                dispatcher_.validate(command.command);
+            } catch (const std::exception& e) {
+                errors[i] = e.what();
+            }
+        }
+        auto first = doc.errors.begin() + static_cast<std::ptrdiff_t>(update.first);
+        doc.errors.insert(doc.errors.erase(first, first + static_cast<std::ptrdiff_t>(update.removed)),
+                          std::make_move_iterator(errors.begin()), std::make_move_iterator(errors.end()));
+    }
+
+    void publishDiagnostics(std::string_view uri, const Document& doc) {
+        Json::Array diagnostics;
+        auto commands = doc.index.commands();
+        for (size_t i = 0; i < commands.size(); ++i) {
+            const ScriptCommand& command = commands[i];
+            if (!command.error.empty()) {
+                diagnostics.push_back(diagnostic(doc, command.error_begin, command.error_end, command.error));
+            } else if (!doc.errors[i].empty()) {
+                // the command without its new line
+                size_t end = command.end > command.begin && doc.index.source()[command.end - 1] == '\n' ? command.end - 1 : command.end;
+                diagnostics.push_back(diagnostic(doc, doc.index.nameBegin(i), end, doc.errors[i]));
+            }
+        }
+        send(notification("textDocument/publishDiagnostics",
+                          Json::Object{{"uri", uri}, {"diagnostics", std::move(diagnostics)}}));
+    }
+
+    Json diagnostic(const Document& doc, size_t begin, size_t end, const std::string& message) const {
+        return Json::Object{
+            {"range", range(doc, begin, end)},
+            {"severity", 1}, // error
+            {"source", "ArgCLITool"},
+            {"message", message},
+        };
+    }
+
+    Json completion(const Document& doc, const Json& position) const {
+        const std::string& source = doc.index.source();
+        size_t cursor = offset(doc, position);
+        size_t word_begin = cursor;
+        while (word_begin > 0 && detail::isIdentifierChar(source[word_begin - 1])) {
+            --word_begin;
+        }
+        // a command name starts the line and the command: not an argument on a continued line
+        size_t line_begin = doc.lines.lineBegin(doc.lines.line(word_begin));
+        bool first_word = source.find_first_not_of(" \t", line_begin) >= word_begin;
+        size_t index = doc.index.find(word_begin);
+        if (!first_word || (index < doc.index.commands().size() && doc.index.nameBegin(index) < word_begin)) {
+            return Json::Array{};
+        }
+        Json::Array items;
+        for (const auto& name : dispatcher_.commands()) {
+            const CommandSchema& schema = *dispatcher_.find(name);
+            Json::Object item{{"label", name}, {"kind", 3}, {"detail", detail::commandSignature(schema)}}; // function
+            if (!schema.description().empty()) {
+                item.emplace_back("documentation", schema.description());
+            }
+            items.push_back(std::move(item));
+        }
+        return items;
+    }
+
+    Json hover(const Document& doc, const Json& position) const {
+        const std::string& source = doc.index.source();
+        size_t cursor = offset(doc, position);
+        size_t word_begin = cursor;
+        size_t word_end = cursor;
+        while (word_begin > 0 && detail::isIdentifierChar(source[word_begin - 1])) {
+            --word_begin;
+        }
+        while (word_end < source.size() && detail::isIdentifierChar(source[word_end])) {
+            ++word_end;
+        }
+        size_t index = doc.index.find(word_begin);
+        if (word_begin == word_end || index == doc.index.commands().size() || doc.index.nameBegin(index) != word_begin) {
+            return Json(); // not a command name
+        }
+        const CommandSchema* schema = dispatcher_.find(std::string_view(source).substr(word_begin, word_end - word_begin));
+        if (!schema) {
+            return Json();
+        }
+        std::string text = "```\n" + detail::commandSignature(*schema) + "\n```";
+        if (!schema->description().empty()) {
+            text += "\n" + schema->description();
+        }
+        for (const auto& arg : schema->arguments()) {
+            std::string types;
+            for (auto type : arg->types) {
+                types += (types.empty() ? "" : " or ") + detail::argumentTypeName(type);
+            }
+            if (!arg->description.empty() || !types.empty()) {
+                text += "\n- `" + arg->name + "`" + (types.empty() ? "" : " (" + types + ")") +
+                        (arg->description.empty() ? "" : ": " + arg->description);
+            }
+        }
+        return Json::Object{
+            {"contents", Json::Object{{"kind", "markdown"}, {"value", std::move(text)}}},
+            {"range", range(doc, word_begin, word_end)},
+        };
+    }
+
+    // offset of an LSP position, clamped to its line and to the document
+    size_t offset(const Document& doc, const Json& position) const {
+        const std::string& source = doc.index.source();
+        double line = position["line"].number(-1);
+        double character = position["character"].number(-1);
+        if (line < 0 || character < 0) {
+            throw std::invalid_argument("Invalid position");
+        }
+        if (line >= static_cast<double>(doc.lines.lineCount())) {
+            return source.size();
+        }
+        size_t offset = doc.lines.lineBegin(static_cast<size_t>(line));
+        for (size_t units = 0; offset < source.size() && source[offset] != '\n';) {
+            size_t length = charLength(source[offset]);
+            units += utf8_positions_ ? length : length == 4 ? 2 : 1; // a surrogate pair in UTF-16
+            if (static_cast<double>(units) > character) {
+                break;
+            }
+            offset = std::min(offset + length, source.size());
+        }
+        return offset;
+    }
+
+    Json position(const Document& doc, size_t offset) const {
+        size_t line = doc.lines.line(offset);
+        size_t character = 0;
+        if (utf8_positions_) {
+            character = offset - doc.lines.lineBegin(line);
+        } else {
+            const std::string& source = doc.index.source();
+            for (size_t i = doc.lines.lineBegin(line); i < offset; i += charLength(source[i])) {
+                character += charLength(source[i]) == 4 ? 2 : 1;
+            }
+        }
+        return Json::Object{{"line", line}, {"character", character}};
+    }
+
+    Json range(const Document& doc, size_t begin, size_t end) const {
+        return Json::Object{{"start", position(doc, begin)}, {"end", position(doc, end)}};
+    }
+
+    // bytes of the UTF-8 sequence starting with lead, 1 for invalid bytes
+    static inline size_t charLength(char lead) {
+        auto byte = static_cast<unsigned char>(lead);
+        return byte >= 0xF0 ? 4 : byte >= 0xE0 ? 3 : byte >= 0xC0 ? 2 : 1;
+    }
+
+    static Json notification(std::string_view method, Json params) {
+        return Json::Object{{"jsonrpc", "2.0"}, {"method", method}, {"params", std::move(params)}};
+    }
+
+    void reply(const Json& id, Json result) {
+        send(Json::Object{{"jsonrpc", "2.0"}, {"id", id}, {"result", std::move(result)}});
+    }
+
+    void sendError(const Json& id, int code, const std::string& message) {
+        send(Json::Object{{"jsonrpc", "2.0"}, {"id", id}, {"error", Json::Object{{"code", code}, {"message", message}}}});
+    }
+
+    void send(const Json& message) {
+        std::string body = message.dump();
+        out_ << "Content-Length: " << body.size() << "\r\n\r\n" << body;
+        out_.flush();
+    }
+
+    // read the body of the next message, false at the end of the input
+    bool readMessage(std::string& body) {
+        while (true) {
+            size_t length = 0;
+            bool has_length = false;
+            std::string header;
+            while (std::getline(in_, header)) {
+                if (!header.empty() && header.back() == '\r') {
+                    header.pop_back();
+                }
+                if (header.empty()) {
+                    break; // end of the headers
+                }
+                constexpr std::string_view kLength = "content-length:";
+                if (header.size() > kLength.size() &&
+                    std::equal(kLength.begin(), kLength.end(), header.begin(),
+                               [](char a, char b) { return a == std::tolower(static_cast<unsigned char>(b)); })) {
+                    size_t value = header.find_first_not_of(' ', kLength.size());
+                    auto [end, error] = std::from_chars(header.data() + std::min(value, header.size()),
+                                                        header.data() + header.size(), length);
+                    has_length = error == std::errc();
+                }
+            }
+            if (!in_) {
+                return false;
+            }
+            if (!has_length) {
+                continue; // no body to read
+            }
+            body.resize(length);
+            if (!in_.read(body.data(), static_cast<std::streamsize>(length))) {
+                return false;
+            }
+            return true;
+        }
+    }
+
+private:
+    const CLIDispatcher& dispatcher_;
+    std::istream& in_;
+    std::ostream& out_;
+    std::unordered_map<std::string, Document> documents_;
+    bool utf8_positions_ = false;
+    bool shutdown_ = false;
+};
+
+}
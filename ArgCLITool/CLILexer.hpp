@@ -1,17 +1,352 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
 #include <cstdint>
+#include <initializer_list>
+#include <limits>
 #include <string>
+#include <string_view>
 #include <istream>
-#include <sstream>
+#include <system_error>
 #include <optional>
+#include <type_traits>
 
 namespace ArgCLITool {
 
+namespace detail {
+
+/**
+ * @brief Parse an integer literal: an optional sign and decimal digits, fitting int64_t.
+ *
+ * @return bool False if text is not an integer literal, value is unchanged.
+ */
+constexpr bool parseInteger(std::string_view text, int64_t& value) {
+    size_t i = 0;
+    bool negative = false;
+    if (i < text.size() && (text[i] == '+' || text[i] == '-')) {
+        negative = text[i++] == '-';
+    }
+    if (i == text.size()) {
+        return false;
+    }
+    uint64_t limit = static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) + (negative ? 1 : 0);
+    uint64_t magnitude = 0;
+    for (; i < text.size(); ++i) {
+        if (text[i] < '0' || text[i] > '9') {
+            return false;
+        }
+        uint64_t digit = static_cast<uint64_t>(text[i] - '0');
+        if (magnitude > (limit - digit) / 10) { // overflow
+            return false;
+        }
+        magnitude = magnitude * 10 + digit;
+    }
+    value = negative ? static_cast<int64_t>(0 - magnitude) : static_cast<int64_t>(magnitude);
+    return true;
+}
+
+// Unsigned integer of up to 4096 bits for the constant evaluation of float literals
+class BigUnsigned {
+public:
+    constexpr explicit BigUnsigned(uint32_t value = 0) {
+        limbs_[0] = value;
+        size_ = value != 0 ? 1 : 0;
+    }
+
+    // *this = *this * factor + addend
+    constexpr void multiplyAdd(uint32_t factor, uint32_t addend) {
+        uint64_t carry = addend;
+        for (size_t i = 0; i < size_; ++i) {
+            uint64_t product = static_cast<uint64_t>(limbs_[i]) * factor + carry;
+            limbs_[i] = static_cast<uint32_t>(product);
+            carry = product >> 32;
+        }
+        if (carry != 0) {
+            limbs_[size_++] = static_cast<uint32_t>(carry);
+        }
+    }
+
+    constexpr void multiplyPow10(int64_t exponent) {
+        for (; exponent >= 9; exponent -= 9) {
+            multiplyAdd(1000000000, 0);
+        }
+        uint32_t factor = 1;
+        for (; exponent > 0; --exponent) {
+            factor *= 10;
+        }
+        multiplyAdd(factor, 0);
+    }
+
+    constexpr bool isZero() const {
+        return size_ == 0;
+    }
+
+    constexpr int64_t bitLength() const {
+        return size_ == 0 ? 0 : 32 * static_cast<int64_t>(size_ - 1) + std::bit_width(limbs_[size_ - 1]);
+    }
+
+    constexpr void shiftLeft(int64_t bits) {
+        if (size_ == 0) {
+            return;
+        }
+        size_t words = static_cast<size_t>(bits / 32);
+        int shift = static_cast<int>(bits % 32);
+        limbs_[size_] = 0;
+        for (size_t i = size_ + 1; i-- > 0;) {
+            uint32_t low = i > 0 && shift != 0 ? limbs_[i - 1] >> (32 - shift) : 0;
+            limbs_[i + words] = (shift != 0 ? limbs_[i] << shift : limbs_[i]) | low;
+        }
+        for (size_t i = 0; i < words; ++i) {
+            limbs_[i] = 0;
+        }
+        size_ += words + 1;
+        trim();
+    }
+
+    constexpr void shiftRightOne() {
+        for (size_t i = 0; i < size_; ++i) {
+            limbs_[i] = (limbs_[i] >> 1) | (i + 1 < size_ ? limbs_[i + 1] << 31 : 0);
+        }
+        trim();
+    }
+
+    constexpr int compare(const BigUnsigned& other) const {
+        if (size_ != other.size_) {
+            return size_ < other.size_ ? -1 : 1;
+        }
+        for (size_t i = size_; i-- > 0;) {
+            if (limbs_[i] != other.limbs_[i]) {
+                return limbs_[i] < other.limbs_[i] ? -1 : 1;
+            }
+        }
+        return 0;
+    }
+
+    // *this -= other, other must not be greater
+    constexpr void subtract(const BigUnsigned& other) {
+        uint32_t borrow = 0;
+        for (size_t i = 0; i < size_; ++i) {
+            uint64_t subtrahend = static_cast<uint64_t>(i < other.size_ ? other.limbs_[i] : 0) + borrow;
+            borrow = limbs_[i] < subtrahend ? 1 : 0;
+            limbs_[i] = static_cast<uint32_t>(limbs_[i] - subtrahend);
+        }
+        trim();
+    }
+
+private:
+    constexpr void trim() {
+        while (size_ > 0 && limbs_[size_ - 1] == 0) {
+            --size_;
+        }
+    }
+
+private:
+    std::array<uint32_t, 128> limbs_{}; // little endian
+    size_t size_ = 0;                   // limbs in use, the highest is not zero
+};
+
+/**
+ * @brief Correctly rounded value of the decimal digits integer.fraction times 10^exponent.
+ *
+ * @return std::optional<double> Empty if the value rounds to zero or overflows, as std::from_chars reports.
+ */
+constexpr std::optional<double> decimalToDouble(std::string_view integer, std::string_view fraction, int64_t exponent) {
+    constexpr uint64_t kHidden = uint64_t(1) << 52;
+    // 767 significant digits always decide the rounding, the digits after these only matter by being non-zero
+    constexpr int64_t kMaxDigits = 800;
+    BigUnsigned numerator;
+    uint64_t leading = 0; // the first 15 significant digits, exact in a double
+    int64_t digits = 0;   // significant digits, from the first non-zero one
+    bool dropped = false; // a non-zero digit after kMaxDigits
+    for (std::string_view part : {integer, fraction}) {
+        for (char c : part) {
+            if (digits == 0 && c == '0') {
+                continue;
+            }
+            if (digits < kMaxDigits) {
+                numerator.multiplyAdd(10, static_cast<uint32_t>(c - '0'));
+                leading = digits < 15 ? leading * 10 + static_cast<uint64_t>(c - '0') : leading;
+            } else {
+                dropped = dropped || c != '0';
+            }
+            ++digits;
+        }
+    }
+    if (digits == 0) {
+        return 0.0;
+    }
+    exponent -= static_cast<int64_t>(fraction.size());
+    if (digits <= 15 && exponent >= -22 && exponent <= 22) {
+        // both operands are exact, so the single rounding of the product or quotient is correct
+        double power = 1.0;
+        for (int64_t e = exponent < 0 ? -exponent : exponent; e > 0; --e) {
+            power *= 10.0;
+        }
+        return exponent < 0 ? static_cast<double>(leading) / power : static_cast<double>(leading) * power;
+    }
+    // the value is in [10^(digits - 1 + exponent), 10^(digits + exponent))
+    if (digits - 1 + exponent > 308 || digits + exponent < -324) {
+        return std::nullopt;
+    }
+    if (digits > kMaxDigits) {
+        exponent += digits - kMaxDigits;
+        if (dropped) { // a trailing 1 rounds like the dropped digits
+            numerator.multiplyAdd(10, 1);
+            --exponent;
+        }
+    }
+    BigUnsigned denominator(1);
+    if (exponent > 0) {
+        numerator.multiplyPow10(exponent);
+    } else {
+        denominator.multiplyPow10(-exponent);
+    }
+    // numerator / denominator = (quotient + remainder / denominator) * 2^binary_exponent, the quotient has 53
+    // or 54 bits, fewer for subnormal values
+    int64_t binary_exponent = std::max<int64_t>(numerator.bitLength() - denominator.bitLength() - 53, -1074);
+    if (binary_exponent < 0) {
+        numerator.shiftLeft(-binary_exponent);
+    } else {
+        denominator.shiftLeft(binary_exponent);
+    }
+    BigUnsigned& remainder = numerator;
+    uint64_t quotient = 0;
+    denominator.shiftLeft(54);
+    for (int bit = 54; bit >= 0; --bit) {
+        if (remainder.compare(denominator) >= 0) {
+            remainder.subtract(denominator);
+            quotient |= uint64_t(1) << bit;
+        }
+        if (bit > 0) {
+            denominator.shiftRightOne();
+        }
+    }
+    // round to nearest, ties to even
+    bool round_up = false;
+    if (quotient >= 2 * kHidden) {
+        round_up = (quotient & 1) != 0 && (!remainder.isZero() || (quotient & 2) != 0);
+        quotient >>= 1;
+        ++binary_exponent;
+    } else {
+        remainder.shiftLeft(1);
+        int half = remainder.compare(denominator);
+        round_up = half > 0 || (half == 0 && (quotient & 1) != 0);
+    }
+    if (round_up && ++quotient == 2 * kHidden) {
+        quotient = kHidden;
+        ++binary_exponent;
+    }
+    if (quotient == 0 || binary_exponent + 52 > 1023) {
+        return std::nullopt;
+    }
+    uint64_t bits = quotient < kHidden ? quotient // subnormal, binary_exponent is -1074
+                                       : static_cast<uint64_t>(binary_exponent + 52 + 1023) << 52 | (quotient - kHidden);
+    return std::bit_cast<double>(bits);
+}
+
+/**
+ * @brief Parse a floating point literal: an optional sign, digits with an optional '.', and an optional exponent.
+ *
+ * @return bool False if text is not a floating point literal or out of the range of double, value is unchanged.
+ *
+ * @note The result is correctly rounded, in constant evaluation too, so both give the same bits.
+ */
+constexpr bool parseFloat(std::string_view text, double& value) {
+    size_t i = 0;
+    bool negative = false;
+    if (i < text.size() && (text[i] == '+' || text[i] == '-')) {
+        negative = text[i++] == '-';
+    }
+    size_t integer_begin = i;
+    while (i < text.size() && text[i] >= '0' && text[i] <= '9') {
+        ++i;
+    }
+    std::string_view integer = text.substr(integer_begin, i - integer_begin);
+    std::string_view fraction;
+    if (i < text.size() && text[i] == '.') {
+        size_t fraction_begin = ++i;
+        while (i < text.size() && text[i] >= '0' && text[i] <= '9') {
+            ++i;
+        }
+        fraction = text.substr(fraction_begin, i - fraction_begin);
+    }
+    if (integer.empty() && fraction.empty()) {
+        return false;
+    }
+    int64_t exponent = 0;
+    if (i < text.size() && (text[i] == 'e' || text[i] == 'E')) {
+        ++i;
+        bool negative_exponent = false;
+        if (i < text.size() && (text[i] == '+' || text[i] == '-')) {
+            negative_exponent = text[i++] == '-';
+        }
+        if (i == text.size()) {
+            return false;
+        }
+        for (; i < text.size() && text[i] >= '0' && text[i] <= '9'; ++i) {
+            exponent = std::min<int64_t>(exponent * 10 + (text[i] - '0'), 100000); // far beyond the range of double
+        }
+        exponent = negative_exponent ? -exponent : exponent;
+    }
+    if (i != text.size()) {
+        return false;
+    }
+    if (!std::is_constant_evaluated()) {
+        const char* begin = text.data() + (text[0] == '+' ? 1 : 0); // from_chars does not take '+'
+        double result = 0.0;
+        auto [end, error] = std::from_chars(begin, text.data() + text.size(), result);
+        if (error != std::errc() || end != text.data() + text.size()) {
+            return false;
+        }
+        value = result;
+        return true;
+    }
+    std::optional<double> result = decimalToDouble(integer, fraction, exponent);
+    if (!result) {
+        return false;
+    }
+    value = negative ? -*result : *result;
+    return true;
+}
+
+
+// Decimal text of value
+constexpr std::string integerToString(int64_t value) {
+    uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+    std::string text;
+    do {
+        text.insert(text.begin(), static_cast<char>('0' + magnitude % 10));
+        magnitude /= 10;
+    } while (magnitude != 0);
+    if (value < 0) {
+        text.insert(text.begin(), '-');
+    }
+    return text;
+}
+
+// Values of the Integer and Float tokens, which are valid literals
+constexpr int64_t integerValue(std::string_view text) {
+    int64_t value = 0;
+    parseInteger(text, value);
+    return value;
+}
+
+constexpr double floatValue(std::string_view text) {
+    double value = 0.0;
+    parseFloat(text, value);
+    return value;
+}
+
+}
+
 // Abstract input stream
+// (the lexer and parser are constexpr, a stream whose functions are constexpr can be parsed in constant evaluation)
 class CLIInputStream {
 public:
-    virtual ~CLIInputStream() = default;
+    constexpr virtual ~CLIInputStream() = default;
 
     virtual char peek() = 0;
     virtual bool get(char& c) = 0;
@@ -44,6 +379,39 @@ private:
     std::istream& stream_;
 };
 
+// Input stream for a string in memory, the string must outlive the stream, usable in constant evaluation
+class CLIStringInputStream : public CLIInputStream {
+public:
+    constexpr CLIStringInputStream(std::string_view source) : source_(source), position_(0) {}
+    constexpr ~CLIStringInputStream() override {} // GCC needs a user-provided constexpr virtual destructor
+
+    constexpr char peek() override {
+        return position_ < source_.size() ? source_[position_] : static_cast<char>(std::char_traits<char>::eof());
+    }
+
+    constexpr bool get(char& c) override {
+        if (position_ >= source_.size()) {
+            return false;
+        }
+        c = source_[position_++];
+        return true;
+    }
+
+    constexpr void unget() override {
+        if (position_ > 0) {
+            --position_;
+        }
+    }
+
+    constexpr int64_t tellg() override {
+        return static_cast<int64_t>(position_);
+    }
+
+private:
+    std::string_view source_;
+    size_t position_;
+};
+
 struct CLIToken {
     enum class Type {
         Identifier,
@@ -62,7 +430,7 @@ struct CLIToken {
         EndOfFile,
         Unknown
     };
-    static inline std::string toString(Type type) {
+    static constexpr std::string toString(Type type) {
         switch (type) {
             case Type::Identifier:   return "identifier";
             case Type::String:       return "string";
@@ -91,13 +459,13 @@ struct CLIToken {
 
 class CLILexer {
 public:
-    CLILexer(CLIInputStream& stream) : stream_(stream) {}
+    constexpr CLILexer(CLIInputStream& stream) : stream_(stream) {}
 
-    bool hasMoreTokens() {
+    constexpr bool hasMoreTokens() {
         return stream_.peek() != std::char_traits<char>::eof();
     }
 
-    CLIToken nextToken() {
+    constexpr CLIToken nextToken() {
         if (peeked_token_) {
             CLIToken token = std::move(*peeked_token_);
             peeked_token_.reset();
@@ -106,7 +474,7 @@ public:
         return readNextToken();
     }
 
-    const CLIToken& peekToken() {
+    constexpr const CLIToken& peekToken() {
         if (!peeked_token_) {
             peeked_token_ = readNextToken();
         }
@@ -114,7 +482,7 @@ public:
     }
 
 private:
-    CLIToken readNextToken() {
+    constexpr CLIToken readNextToken() {
         char c;
 
         while (stream_.get(c)) {
@@ -176,7 +544,7 @@ private:
      *
      * @return CLIToken
      */
-    inline CLIToken readIdentifier() {
+    constexpr CLIToken readIdentifier() {
         std::string value;
         char c;
         int64_t begin = stream_.tellg();
@@ -203,7 +571,7 @@ private:
      *
      * @note The escape character is '\'. If it appears on the end of line, the new line (\n|\r\n) is ignored.
      */
-    inline CLIToken readString() {
+    constexpr CLIToken readString() {
         std::string value;
         char c;
         int64_t begin = stream_.tellg();
@@ -243,7 +611,7 @@ private:
      *
      * @return CLIToken
      */
-    inline CLIToken readNumber() {
+    constexpr CLIToken readNumber() {
         std::string value;
         char c;
         int64_t begin = stream_.tellg();
@@ -261,28 +629,19 @@ private:
 
         // Check f|F suffix and remove it
         bool has_suffix = value.length() > 0 && (value.back() == 'f' || value.back() == 'F');
+        std::string_view number = std::string_view(value).substr(0, value.length() - (has_suffix ? 1 : 0));
 
-        // Check integer
-        {
-            int64_t integer;
-            std::istringstream iss(has_suffix ? value.substr(0, value.length() - 1) : value);
-            iss >> integer;
-            if (iss.eof() && !iss.fail()) {
-                if (has_suffix) {
-                    return CLIToken{CLIToken::Type::Unknown, value, begin, end};
-                }
-                return CLIToken{CLIToken::Type::Integer, std::to_string(integer), begin, end};
+        // Check integer, the value is normalized (no '+' or leading zeros)
+        if (int64_t integer = 0; detail::parseInteger(number, integer)) {
+            if (has_suffix) {
+                return CLIToken{CLIToken::Type::Unknown, value, begin, end};
             }
+            return CLIToken{CLIToken::Type::Integer, detail::integerToString(integer), begin, end};
         }
 
-        // Check float
-        {
-            float floating;
-            std::istringstream iss(has_suffix ? value.substr(0, value.length() - 1) : value);
-            iss >> floating;
-            if (iss.eof() && !iss.fail()) {
-                return CLIToken{CLIToken::Type::Float, std::to_string(floating), begin, end};
-            }
+        // Check float, the value is the literal without suffix
+        if (double floating = 0.0; detail::parseFloat(number, floating)) {
+            return CLIToken{CLIToken::Type::Float, std::string(number), begin, end};
         }
 
         return CLIToken{CLIToken::Type::Unknown, value, begin, end};
@@ -293,7 +652,7 @@ private:
      *
      * @return CLIToken
      */
-    inline CLIToken readComment() {
+    constexpr CLIToken readComment() {
         std::string value;
         char c;
         int64_t begin = stream_.tellg();
@@ -301,10 +660,9 @@ private:
 
         while (true) {
             c = stream_.peek();
-            if (c == '\n') {
+            if (c == '\n' || !stream_.get(c)) { // comment ends at the end of line or the end of file
                 break;
             }
-            stream_.get(c);
             ++end;
             value += c;
         }
@@ -14,14 +14,15 @@ namespace ArgCLITool {
 // Hook the input stream and record the consumed characters
 class CLIInputStreamHook : public CLIInputStream {
 public:
-    CLIInputStreamHook(CLIInputStream& stream)
+    constexpr CLIInputStreamHook(CLIInputStream& stream)
         : stream_(stream), stream_position_(0), position_(0), line_number_(1), current_line_number_(1) {}
+    constexpr ~CLIInputStreamHook() override {} // GCC needs a user-provided constexpr virtual destructor
 
-    char peek() override {
+    constexpr char peek() override {
         return stream_.peek();
     }
 
-    bool get(char& c) override {
+    constexpr bool get(char& c) override {
         if (stream_.get(c)) {
             ++stream_position_;
             consumed_chars_.push_back(c);
@@ -33,7 +34,7 @@ public:
         return false;
     }
 
-    void unget() override {
+    constexpr void unget() override {
         if (consumed_chars_.empty()) {
             throw std::runtime_error("Cannot unget " + std::string(__FILE__) + ":" + std::to_string(__LINE__));
         }
@@ -45,11 +46,11 @@ public:
         consumed_chars_.pop_back();
     }
 
-    int64_t tellg() override {
+    constexpr int64_t tellg() override {
         return stream_position_;
     }
 
-    void clearConsumedTokens() {
+    constexpr void clearConsumedTokens() {
         position_ = stream_position_;
         line_number_ = current_line_number_;
         consumed_chars_.clear();
@@ -76,6 +77,32 @@ private:
     int64_t current_line_number_; // Current line number
 };
 
+// Syntax error thrown by CLIParser, what() is the report with the source snippet
+class CLIParseError : public std::runtime_error {
+public:
+    CLIParseError(const std::string& report, std::string message, int64_t begin, int64_t end)
+        : std::runtime_error(report), message_(std::move(message)), begin_(begin), end_(end) {}
+
+    // The error without color, position and source snippet, for example for an editor that shows the position
+    inline const std::string& message() const {
+        return message_;
+    }
+
+    // Stream positions of the offending token, end is exclusive
+    inline int64_t begin() const {
+        return begin_;
+    }
+
+    inline int64_t end() const {
+        return end_;
+    }
+
+private:
+    std::string message_;
+    int64_t begin_;
+    int64_t end_;
+};
+
 // Reports more human-readable error messages for the parser
 class ErrorReporter {
 public:
@@ -88,86 +115,71 @@ public:
     constexpr static const char* RESET   = "\033[0m";
 
 public:
-    ErrorReporter(const CLIInputStreamHook& stream_hook, bool color_output = true, bool show_source = true)
+    constexpr ErrorReporter(const CLIInputStreamHook& stream_hook, bool color_output = true, bool show_source = true)
         : stream_hook_(stream_hook), color_output_(color_output), show_source_(show_source) {}
 
     /**
      * @brief Unexpected token error (with expected token)
      */
-    inline std::runtime_error unexpectedTokenError(const CLIToken::Type& expected, const CLIToken& actual) {
-        std::string report =
-            colorString("Error: ", RED) +
-            "expected " + CLIToken::toString(expected) +
-            " at position " + std::to_string(actual.begin) +
+    inline CLIParseError unexpectedTokenError(const CLIToken::Type& expected, const CLIToken& actual) {
+        return makeError(
+            "expected " + CLIToken::toString(expected),
             " but got " + CLIToken::toString(actual.type) +
-            (actual.type == CLIToken::Type::EndOfLine ? "" : " '" + actual.value + "'");
-        if (show_source_) {
-            report += "\n" + getSourceSnippetReport(actual.begin, actual.end);
-        }
-        return std::runtime_error(std::move(report));
+            (actual.type == CLIToken::Type::EndOfLine ? "" : " '" + actual.value + "'"),
+            actual);
     }
 
     /**
      * @brief Unexpected token error (custom message)
      */
-    inline std::runtime_error unexpectedTokenError(const std::string& expected, const CLIToken& actual) {
-        std::string report =
-            colorString("Error: ", RED) +
-            "expected " + expected +
-            " at position " + std::to_string(actual.begin) +
+    inline CLIParseError unexpectedTokenError(const std::string& expected, const CLIToken& actual) {
+        return makeError(
+            "expected " + expected,
             " but got " + CLIToken::toString(actual.type) +
-            (actual.type == CLIToken::Type::EndOfLine ? "" : " '" + actual.value + "'");
-        if (show_source_) {
-            report += "\n" + getSourceSnippetReport(actual.begin, actual.end);
-        }
-        return std::runtime_error(std::move(report));
+            (actual.type == CLIToken::Type::EndOfLine ? "" : " '" + actual.value + "'"),
+            actual);
     }
 
     /**
      * @brief Unexpected token error (without expected token)
      */
-    inline std::runtime_error unexpectedTokenError(const CLIToken& unexpected) {
-        std::string report =
-            colorString("Error: ", RED) +
-            "unexpected " + CLIToken::toString(unexpected.type) +
-            " at position " + std::to_string(unexpected.begin) +
-            (unexpected.type == CLIToken::Type::EndOfLine ? "" : " '" + unexpected.value + "'");
-        if (show_source_) {
-            report += "\n" + getSourceSnippetReport(unexpected.begin, unexpected.end);
-        }
-        return std::runtime_error(std::move(report));
+    inline CLIParseError unexpectedTokenError(const CLIToken& unexpected) {
+        return makeError(
+            "unexpected " + CLIToken::toString(unexpected.type),
+            unexpected.type == CLIToken::Type::EndOfLine ? "" : " '" + unexpected.value + "'",
+            unexpected);
     }
 
     /**
      * @brief Mismatched bracket error ('()' or '[]' or '{}')
      */
-    inline std::runtime_error mismatchedTokenError(const CLIToken& unexpected) {
-        std::string report =
-            colorString("Error: ", RED) +
-            "mismatched " + CLIToken::toString(unexpected.type) +
-            " at position " + std::to_string(unexpected.begin) +
-            (unexpected.type == CLIToken::Type::EndOfLine ? "" : " '" + unexpected.value + "'");
-        if (show_source_) {
-            report += "\n" + getSourceSnippetReport(unexpected.begin, unexpected.end);
-        }
-        return std::runtime_error(std::move(report));
+    inline CLIParseError mismatchedTokenError(const CLIToken& unexpected) {
+        return makeError(
+            "mismatched " + CLIToken::toString(unexpected.type),
+            unexpected.type == CLIToken::Type::EndOfLine ? "" : " '" + unexpected.value + "'",
+            unexpected);
     }
 
     /**
      * @brief Unknown token error
      */
-    inline std::runtime_error unknownTokenError(const CLIToken& unknown) {
-        std::string report =
-            colorString("Error: ", RED) +
-            "unknown token at position " + std::to_string(unknown.begin) +
-            " '" + unknown.value + "'";
+    inline CLIParseError unknownTokenError(const CLIToken& unknown) {
+        return makeError(
+            "unknown token",
+            " '" + unknown.value + "'",
+            unknown);
+    }
+
+private:
+    // Error whose report is "Error: <before> at position <token position><after>" and message "<before><after>"
+    CLIParseError makeError(const std::string& before, const std::string& after, const CLIToken& token) const {
+        std::string report = colorString("Error: ", RED) + before + " at position " + std::to_string(token.begin) + after;
         if (show_source_) {
-            report += "\n" + getSourceSnippetReport(unknown.begin, unknown.end);
+            report += "\n" + getSourceSnippetReport(token.begin, token.end);
         }
-        return std::runtime_error(std::move(report));
+        return CLIParseError(report, before + after, token.begin, token.end);
     }
 
-private:
     // Note: Both begin and end are inclusive
     std::string getSourceSnippetReport(int64_t begin, int64_t end) const {
         std::string source = stream_hook_.getConsumedTokens();
@@ -283,7 +295,9 @@ template <typename T>
 struct ValueData : Data {
     T value;
     ValueData() = default;
-    ValueData(T value) : value(std::move(value)) {}
+    // separate overloads, GCC cannot move a by-value std::string parameter in constant evaluation
+    constexpr ValueData(const T& value) : value(value) {}
+    constexpr ValueData(T&& value) : value(std::move(value)) {}
 };
 
 using IdentifierData = ValueData<std::string>;
@@ -319,9 +333,9 @@ struct Command {
 
 class CLIParser {
 public:
-    CLIParser(CLIInputStream& stream) : stream_hook_(stream), error_reporter_(stream_hook_), lexer_(stream_hook_) {}
+    constexpr CLIParser(CLIInputStream& stream) : stream_hook_(stream), error_reporter_(stream_hook_), lexer_(stream_hook_) {}
 
-    bool hasMoreCommands() {
+    constexpr bool hasMoreCommands() {
         return lexer_.hasMoreTokens();
     }
 
@@ -330,7 +344,7 @@ public:
      *      : <identifier> <argument_list> <end_of_line>
      *      ;
      */
-    Command parseCommand() {
+    constexpr Command parseCommand() {
         Command command;
         CLIToken token;
 
@@ -413,7 +427,7 @@ private:
      *     | <single_line_arguments> <argument>
      *     ;
      */
-    std::vector<Argument> parseArgumentList() {
+    constexpr std::vector<Argument> parseArgumentList() {
         std::vector<Argument> arguments;
         CLIToken token;
 
@@ -486,7 +500,7 @@ private:
      *     | <vector>
      *     ;
      */
-    Argument parseArgument() {
+    constexpr Argument parseArgument() {
         Argument arg;
         CLIToken token;
 
@@ -510,14 +524,14 @@ private:
                     // Insert the first integer into the vector
                     if (arg.type == Argument::Type::IntegerVector) {
                         auto& integer_vector_data = std::get<IntegerVectorData>(arg.data);
-                        integer_vector_data.value.insert(integer_vector_data.value.begin(), std::stoll(token.value));
+                        integer_vector_data.value.insert(integer_vector_data.value.begin(), detail::integerValue(token.value));
                     } else { // FloatVector is ok, because integer can be converted to float
                         auto& float_vector_data = std::get<FloatVectorData>(arg.data);
-                        float_vector_data.value.insert(float_vector_data.value.begin(), static_cast<double>(std::stoll(token.value)));
+                        float_vector_data.value.insert(float_vector_data.value.begin(), static_cast<double>(detail::integerValue(token.value)));
                     }
                 } else { // Integer
                     arg.type = Argument::Type::Integer;
-                    arg.data = IntegerData(std::stoll(token.value));
+                    arg.data = IntegerData(detail::integerValue(token.value));
                 }
                 break;
             case CLIToken::Type::Float: // Float or NumberVector
@@ -528,12 +542,12 @@ private:
                     // Insert the first float into the vector
                     if (arg.type == Argument::Type::FloatVector) {
                         auto& float_vector_data = std::get<FloatVectorData>(arg.data);
-                        float_vector_data.value.insert(float_vector_data.value.begin(), std::stod(token.value));
+                        float_vector_data.value.insert(float_vector_data.value.begin(), detail::floatValue(token.value));
                     } else { // IntegerVector is not ok, because float cannot be converted to integer
                         auto& integer_vector_data = std::get<IntegerVectorData>(arg.data);
                         // Convert integer vector to float vector
                         FloatVectorData float_vector_data;
-                        float_vector_data.value.push_back(std::stod(token.value));
+                        float_vector_data.value.push_back(detail::floatValue(token.value));
                         for (const auto& value : integer_vector_data.value) {
                             float_vector_data.value.push_back(static_cast<double>(value));
                         }
@@ -543,7 +557,7 @@ private:
                     }
                 } else { // Float
                     arg.type = Argument::Type::Float;
-                    arg.data = FloatData(std::stod(token.value));
+                    arg.data = FloatData(detail::floatValue(token.value));
                 }
                 break;
             case CLIToken::Type::LeftParen:
@@ -575,7 +589,7 @@ private:
      *     | [ <number_list> ]
      *     ;
      */
-    Argument parseVector() {
+    constexpr Argument parseVector() {
         Argument arg;
         CLIToken token;
 
@@ -612,7 +626,7 @@ private:
      *     | <number_list> , <number>
      *     ;
      */
-    Argument parseNumberList() {
+    constexpr Argument parseNumberList() {
         Argument arg;
         CLIToken token;
 
@@ -626,7 +640,7 @@ private:
             IntegerVectorData data;
             for (const auto& token : tokens) {
                 assert(token.type == CLIToken::Type::Integer || token.type == CLIToken::Type::Float);
-                data.value.push_back(token.type == CLIToken::Type::Integer ? std::stoll(token.value) : static_cast<int64_t>(std::stod(token.value)));
+                data.value.push_back(token.type == CLIToken::Type::Integer ? detail::integerValue(token.value) : static_cast<int64_t>(detail::floatValue(token.value)));
             }
             arg.type = Argument::Type::IntegerVector;
             arg.data = std::move(data);
@@ -636,7 +650,7 @@ private:
             FloatVectorData data;
             for (const auto& token : tokens) {
                 assert(token.type == CLIToken::Type::Integer || token.type == CLIToken::Type::Float);
-                data.value.push_back(token.type == CLIToken::Type::Integer ? static_cast<double>(std::stoll(token.value)) : std::stod(token.value));
+                data.value.push_back(token.type == CLIToken::Type::Integer ? static_cast<double>(detail::integerValue(token.value)) : detail::floatValue(token.value));
             }
             arg.type = Argument::Type::FloatVector;
             arg.data = std::move(data);
@@ -0,0 +1,796 @@
+#pragma once
+
+#include "CLICommand.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <termios.h>
+#include <unistd.h>
+#define ARGCLITOOL_HAS_TERMIOS 1
+#else
+#define ARGCLITOOL_HAS_TERMIOS 0
+#endif
+
+namespace ArgCLITool {
+
+namespace detail {
+
+// Puts a terminal into raw mode for the lifetime of the object: keys are read one by one without echo
+class RawTerminal {
+public:
+    explicit RawTerminal(int fd) : fd_(fd) {
+#if ARGCLITOOL_HAS_TERMIOS
+        if (::tcgetattr(fd_, &original_) != 0) {
+            return;
+        }
+        termios raw = original_;
+        raw.c_iflag &= ~(BRKINT | ICRNL | INPCK | ISTRIP | IXON);
+        raw.c_cflag |= CS8;
+        raw.c_lflag &= ~(ECHO | ICANON | IEXTEN | ISIG);
+        raw.c_cc[VMIN] = 1;
+        raw.c_cc[VTIME] = 0;
+        // output processing is kept, so '\n' still returns to the line start, and TCSADRAIN keeps type-ahead keys
+        enabled_ = ::tcsetattr(fd_, TCSADRAIN, &raw) == 0;
+#endif
+    }
+
+    ~RawTerminal() {
+#if ARGCLITOOL_HAS_TERMIOS
+        if (enabled_) {
+            ::tcsetattr(fd_, TCSADRAIN, &original_);
+        }
+#endif
+    }
+
+    RawTerminal(const RawTerminal&) = delete;
+    RawTerminal& operator=(const RawTerminal&) = delete;
+
+    inline bool enabled() const { return enabled_; }
+
+private:
+    int fd_;
+    bool enabled_ = false;
+#if ARGCLITOOL_HAS_TERMIOS
+    termios original_;
+#endif
+};
+
+// UTF-8 helpers of the line editor, every character is assumed to take one column
+inline constexpr bool isContinuationByte(char c) {
+    return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+}
+
+inline size_t nextChar(std::string_view text, size_t index) {
+    if (index < text.size()) {
+        ++index;
+    }
+    while (index < text.size() && isContinuationByte(text[index])) {
+        ++index;
+    }
+    return index;
+}
+
+inline size_t prevChar(std::string_view text, size_t index) {
+    if (index > 0) {
+        --index;
+    }
+    while (index > 0 && isContinuationByte(text[index])) {
+        --index;
+    }
+    return index;
+}
+
+inline size_t countColumns(std::string_view text) {
+    return static_cast<size_t>(std::count_if(text.begin(), text.end(), [](char c) { return !isContinuationByte(c); }));
+}
+
+} // namespace detail
+
+/**
+ * @brief Line editor for interactive input, with the terminal in raw mode instead of depending on readline.
+ *
+ * @note Supports cursor movement (arrows, Home/End, Ctrl-A/E, Ctrl-Left/Right, Alt-B/F), Backspace/Delete,
+ * @note Ctrl-K/U/W to kill text, Ctrl-L to clear the screen, Up/Down (Ctrl-P/N) for history and Tab completion.
+ * @note A line longer than the terminal scrolls horizontally.
+ * @note Every batch of keys (a single key, or a whole paste) is answered with one redraw, which only writes
+ * @note the difference from what is on screen, in a single write.
+ * @note When the input or output is not a terminal, lines are read as they are, without prompt.
+ */
+class LineEditor {
+public:
+    enum class ReadResult {
+        Line,        // a line is entered
+        Interrupted, // Ctrl-C
+        EndOfFile,   // Ctrl-D on an empty line, or the end of the input
+    };
+
+    /**
+     * @brief Completion candidates of word, before is the line text before word.
+     *
+     * @note Candidates not starting with word are ignored.
+     */
+    using Completer = std::function<std::vector<std::string>(std::string_view before, std::string_view word)>;
+
+public:
+    LineEditor(int in_fd = 0, int out_fd = 1) : in_fd_(in_fd), out_fd_(out_fd) {
+#if ARGCLITOOL_HAS_TERMIOS
+        terminal_ = ::isatty(in_fd_) && ::isatty(out_fd_);
+#endif
+    }
+
+    inline void completer(Completer completer) {
+        completer_ = std::move(completer);
+    }
+
+    // maximum number of history entries, the oldest entries are dropped first
+    void historyLimit(size_t limit) {
+        history_limit_ = limit;
+        while (history_.size() > history_limit_) {
+            history_.pop_front();
+        }
+    }
+
+    // add line to the history, empty lines and repeats of the last entry are skipped
+    void addHistory(std::string_view line) {
+        if (line.empty() || history_limit_ == 0 || (!history_.empty() && history_.back() == line)) {
+            return;
+        }
+        history_.emplace_back(line);
+        if (history_.size() > history_limit_) {
+            history_.pop_front();
+        }
+    }
+
+    inline const std::deque<std::string>& history() const {
+        return history_;
+    }
+
+    // true if the input and output are a terminal, so lines are edited in raw mode
+    inline bool isTerminal() const {
+        return terminal_;
+    }
+
+    /**
+     * @brief Show prompt and read one line into line, without the new line.
+     *
+     * @note The prompt is measured by its UTF-8 characters, so it should not contain escape sequences.
+     */
+    ReadResult readLine(std::string_view prompt, std::string& line) {
+        if (!terminal_) {
+            return readPlainLine(line);
+        }
+        detail::RawTerminal raw(in_fd_);
+        if (!raw.enabled()) {
+            return readPlainLine(line);
+        }
+        prompt_ = prompt;
+        buffer_.clear();
+        cursor_ = 0;
+        offset_ = 0;
+        history_index_ = history_.size();
+        saved_line_.clear();
+        width_ = detail::terminalWidth();
+        redraw();
+        while (true) {
+            Key key = readKey();
+            switch (key.type) {
+                case KeyType::Char:
+                    buffer_.insert(cursor_, key.text);
+                    cursor_ += key.text.size();
+                    break;
+                case KeyType::Enter:
+                    finish("\n");
+                    line = std::move(buffer_);
+                    buffer_.clear();
+                    return ReadResult::Line;
+                case KeyType::Interrupt:
+                    finish("^C\n");
+                    line.clear();
+                    return ReadResult::Interrupted;
+                case KeyType::EndOfInput:
+                    if (!buffer_.empty() && !input_closed_) { // Ctrl-D deletes the character under the cursor
+                        erase(cursor_, detail::nextChar(buffer_, cursor_));
+                        break;
+                    }
+                    finish("\n");
+                    line.clear();
+                    return ReadResult::EndOfFile;
+                case KeyType::Backspace:
+                    erase(detail::prevChar(buffer_, cursor_), cursor_);
+                    break;
+                case KeyType::Delete:
+                    erase(cursor_, detail::nextChar(buffer_, cursor_));
+                    break;
+                case KeyType::Left:
+                    cursor_ = detail::prevChar(buffer_, cursor_);
+                    break;
+                case KeyType::Right:
+                    cursor_ = detail::nextChar(buffer_, cursor_);
+                    break;
+                case KeyType::WordLeft:
+                    cursor_ = wordBegin(cursor_);
+                    break;
+                case KeyType::WordRight:
+                    while (cursor_ < buffer_.size() && buffer_[cursor_] == ' ') {
+                        ++cursor_;
+                    }
+                    while (cursor_ < buffer_.size() && buffer_[cursor_] != ' ') {
+                        ++cursor_;
+                    }
+                    break;
+                case KeyType::Home:
+                    cursor_ = 0;
+                    break;
+                case KeyType::End:
+                    cursor_ = buffer_.size();
+                    break;
+                case KeyType::KillEnd:
+                    erase(cursor_, buffer_.size());
+                    break;
+                case KeyType::KillStart:
+                    erase(0, cursor_);
+                    break;
+                case KeyType::KillWord:
+                    erase(wordBegin(cursor_), cursor_);
+                    break;
+                case KeyType::Up:
+                    moveHistory(-1);
+                    break;
+                case KeyType::Down:
+                    moveHistory(1);
+                    break;
+                case KeyType::Tab:
+                    complete();
+                    break;
+                case KeyType::Clear:
+                    output_ += "\033[H\033[2J";
+                    redraw();
+                    break;
+                case KeyType::Ignore:
+                    break;
+            }
+            if (!hasPendingInput()) { // keys that arrived together are answered with one redraw
+                refresh();
+            }
+        }
+    }
+
+private:
+    enum class KeyType {
+        Char, Enter, Interrupt, EndOfInput, Backspace, Delete, Left, Right, WordLeft, WordRight,
+        Home, End, KillEnd, KillStart, KillWord, Up, Down, Tab, Clear, Ignore
+    };
+
+    struct Key {
+        KeyType type;
+        std::string text; // UTF-8 character of KeyType::Char
+    };
+
+    // read a line as it is, for input that is not a terminal
+    ReadResult readPlainLine(std::string& line) {
+        line.clear();
+        char c;
+        bool any = false;
+        while (readByte(c)) {
+            any = true;
+            if (c == '\n') {
+                break;
+            }
+            line += c;
+        }
+        if (!any) {
+            return ReadResult::EndOfFile;
+        }
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        return ReadResult::Line;
+    }
+
+    inline bool hasPendingInput() const {
+        return input_position_ < input_.size();
+    }
+
+    // read one byte, refilling the input buffer with everything available in one read
+    bool readByte(char& c) {
+        if (!hasPendingInput()) {
+            if (input_closed_) {
+                return false;
+            }
+            input_.resize(kInputBufferSize);
+            input_position_ = 0;
+#if ARGCLITOOL_HAS_TERMIOS
+            ssize_t n;
+            do {
+                n = ::read(in_fd_, input_.data(), input_.size());
+            } while (n < 0 && errno == EINTR);
+            input_.resize(n > 0 ? static_cast<size_t>(n) : 0);
+#else
+            std::cin.read(input_.data(), 1);
+            input_.resize(static_cast<size_t>(std::cin.gcount()));
+#endif
+            if (input_.empty()) {
+                input_closed_ = true;
+                return false;
+            }
+        }
+        c = input_[input_position_++];
+        return true;
+    }
+
+    Key readKey() {
+        char c;
+        if (!readByte(c)) {
+            return {KeyType::EndOfInput, {}};
+        }
+        switch (c) {
+            case '\r': case '\n': return {KeyType::Enter, {}};
+            case 1:    return {KeyType::Home, {}};      // Ctrl-A
+            case 2:    return {KeyType::Left, {}};      // Ctrl-B
+            case 3:    return {KeyType::Interrupt, {}}; // Ctrl-C
+            case 4:    return {KeyType::EndOfInput, {}}; // Ctrl-D
+            case 5:    return {KeyType::End, {}};       // Ctrl-E
+            case 6:    return {KeyType::Right, {}};     // Ctrl-F
+            case 8: case 127: return {KeyType::Backspace, {}};
+            case '\t': return {KeyType::Tab, {}};
+            case 11:   return {KeyType::KillEnd, {}};   // Ctrl-K
+            case 12:   return {KeyType::Clear, {}};     // Ctrl-L
+            case 14:   return {KeyType::Down, {}};      // Ctrl-N
+            case 16:   return {KeyType::Up, {}};        // Ctrl-P
+            case 21:   return {KeyType::KillStart, {}}; // Ctrl-U
+            case 23:   return {KeyType::KillWord, {}};  // Ctrl-W
+            case '\033': return readEscape();
+            default:
+                break;
+        }
+        if (static_cast<unsigned char>(c) < 0x20) {
+            return {KeyType::Ignore, {}};
+        }
+        Key key{KeyType::Char, std::string(1, c)};
+        // the rest of a UTF-8 character
+        int extra = (c & 0xE0) == 0xC0 ? 1 : (c & 0xF0) == 0xE0 ? 2 : (c & 0xF8) == 0xF0 ? 3 : 0;
+        for (int i = 0; i < extra && readByte(c); ++i) {
+            key.text += c;
+        }
+        return key;
+    }
+
+    // ESC [ <parameters> <final byte>, ESC O <final byte>, or ESC <key> for Alt-<key>
+    Key readEscape() {
+        char c;
+        if (!readByte(c)) {
+            return {KeyType::Ignore, {}};
+        }
+        if (c == 'b' || c == 'f') {
+            return {c == 'b' ? KeyType::WordLeft : KeyType::WordRight, {}};
+        }
+        if (c != '[' && c != 'O') {
+            return {KeyType::Ignore, {}};
+        }
+        std::string parameters;
+        char final_byte = 0;
+        while (readByte(c)) {
+            if (c >= 0x40 && c <= 0x7E) {
+                final_byte = c;
+                break;
+            }
+            parameters += c;
+        }
+        bool control = parameters.find(";5") != std::string::npos; // modifier of Ctrl-<arrow>
+        switch (final_byte) {
+            case 'A': return {KeyType::Up, {}};
+            case 'B': return {KeyType::Down, {}};
+            case 'C': return {control ? KeyType::WordRight : KeyType::Right, {}};
+            case 'D': return {control ? KeyType::WordLeft : KeyType::Left, {}};
+            case 'H': return {KeyType::Home, {}};
+            case 'F': return {KeyType::End, {}};
+            case '~':
+                if (parameters == "1" || parameters == "7") { return {KeyType::Home, {}}; }
+                if (parameters == "4" || parameters == "8") { return {KeyType::End, {}}; }
+                if (parameters == "3") { return {KeyType::Delete, {}}; }
+                break;
+            default:
+                break;
+        }
+        return {KeyType::Ignore, {}};
+    }
+
+    inline void erase(size_t begin, size_t end) {
+        buffer_.erase(begin, end - begin);
+        cursor_ = begin;
+    }
+
+    // beginning of the word before index
+    size_t wordBegin(size_t index) const {
+        while (index > 0 && buffer_[index - 1] == ' ') {
+            --index;
+        }
+        while (index > 0 && buffer_[index - 1] != ' ') {
+            --index;
+        }
+        return index;
+    }
+
+    void moveHistory(int direction) {
+        if (direction < 0 && history_index_ > 0) {
+            if (history_index_ == history_.size()) {
+                saved_line_ = buffer_; // the line being edited comes back after the newest entry
+            }
+            buffer_ = history_[--history_index_];
+        } else if (direction > 0 && history_index_ < history_.size()) {
+            ++history_index_;
+            buffer_ = history_index_ == history_.size() ? saved_line_ : history_[history_index_];
+        } else {
+            return;
+        }
+        cursor_ = buffer_.size();
+    }
+
+    static inline constexpr bool isWordSeparator(char c) {
+        return c == ' ' || c == '\t' || c == '{' || c == '(' || c == '[' || c == ',';
+    }
+
+    // complete the word before the cursor, or list the candidates if they have no longer common prefix
+    void complete() {
+        if (!completer_) {
+            return;
+        }
+        size_t word_begin = cursor_;
+        while (word_begin > 0 && !isWordSeparator(buffer_[word_begin - 1])) {
+            --word_begin;
+        }
+        std::string_view line = buffer_;
+        std::string_view word = line.substr(word_begin, cursor_ - word_begin);
+        std::vector<std::string> candidates = completer_(line.substr(0, word_begin), word);
+        std::erase_if(candidates, [word](const std::string& candidate) { return !candidate.starts_with(word); });
+        if (candidates.empty()) {
+            output_ += '\a';
+            return;
+        }
+        size_t common = candidates[0].size();
+        for (const auto& candidate : candidates) {
+            common = std::min<size_t>(common, std::mismatch(candidates[0].begin(), candidates[0].begin() + common,
+                                                            candidate.begin(), candidate.end()).first - candidates[0].begin());
+        }
+        std::string insertion = candidates[0].substr(word.size(), common - word.size());
+        if (candidates.size() == 1) {
+            insertion += ' ';
+        }
+        if (!insertion.empty()) {
+            buffer_.insert(cursor_, insertion);
+            cursor_ += insertion.size();
+            return;
+        }
+        // list the candidates in columns under the line, then draw the line again
+        size_t column_width = 0;
+        for (const auto& candidate : candidates) {
+            column_width = std::max(column_width, detail::countColumns(candidate) + 2);
+        }
+        size_t ncolumns = std::max<size_t>(1, width_ / column_width);
+        output_ += '\n';
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            output_ += candidates[i];
+            bool last_column = (i + 1) % ncolumns == 0 || i + 1 == candidates.size();
+            output_ += last_column ? std::string("\n") : std::string(column_width - detail::countColumns(candidates[i]), ' ');
+        }
+        redraw();
+    }
+
+    // show the whole line with the keys of the last batch, then leave it with text
+    void finish(std::string_view text) {
+        cursor_ = buffer_.size();
+        refresh();
+        output_ += text;
+        flush();
+    }
+
+    // draw the prompt and the line from the start of the current terminal line
+    void redraw() {
+        output_ += '\r';
+        output_ += prompt_;
+        rendered_.clear();
+        rendered_cursor_ = 0;
+        refresh();
+    }
+
+    /**
+     * @brief Bring the terminal up to date with the buffer and the cursor.
+     *
+     * @note The visible part of the buffer is compared with what was drawn last time: the cursor moves back to
+     * @note the first difference, only the differing tail is written, and the whole update is one write.
+     */
+    void refresh() {
+        size_t prompt_columns = detail::countColumns(prompt_);
+        // the last column is left empty, so the cursor at the end does not wrap
+        size_t available = width_ > prompt_columns + 1 ? width_ - prompt_columns - 1 : 1;
+        std::string_view buffer = buffer_;
+        // scroll the visible window to the cursor
+        offset_ = std::min(offset_, cursor_);
+        while (detail::countColumns(buffer.substr(offset_, cursor_ - offset_)) >= available) {
+            offset_ = detail::nextChar(buffer, offset_);
+        }
+        size_t end = offset_;
+        for (size_t columns = 0; end < buffer.size() && columns < available; ++columns) {
+            end = detail::nextChar(buffer, end);
+        }
+        std::string_view visible = buffer.substr(offset_, end - offset_);
+        size_t cursor_column = detail::countColumns(buffer.substr(offset_, cursor_ - offset_));
+        // first differing character
+        size_t same = std::mismatch(visible.begin(), visible.end(), rendered_.begin(), rendered_.end()).first - visible.begin();
+        while (same > 0 && same < visible.size() && detail::isContinuationByte(visible[same])) {
+            --same;
+        }
+        size_t visible_columns = detail::countColumns(visible);
+        size_t rendered_columns = detail::countColumns(rendered_);
+        if (same < visible.size() || visible.size() != rendered_.size()) {
+            size_t same_column = detail::countColumns(visible.substr(0, same));
+            moveCursor(rendered_cursor_, same_column);
+            output_ += visible.substr(same);
+            if (rendered_columns > visible_columns) {
+                output_ += "\033[K"; // clear the rest of the old line
+            }
+            moveCursor(visible_columns, cursor_column);
+            rendered_.assign(visible);
+        } else {
+            moveCursor(rendered_cursor_, cursor_column);
+        }
+        rendered_cursor_ = cursor_column;
+        flush();
+    }
+
+    void moveCursor(size_t from, size_t to) {
+        if (from == to) {
+            return;
+        }
+        size_t distance = from > to ? from - to : to - from;
+        if (from > to && distance == 1) {
+            output_ += '\b';
+            return;
+        }
+        output_ += "\033[";
+        output_ += std::to_string(distance);
+        output_ += from > to ? 'D' : 'C';
+    }
+
+    // write the pending output in one system call
+    void flush() {
+        size_t written = 0;
+        while (written < output_.size()) {
+#if ARGCLITOOL_HAS_TERMIOS
+            ssize_t n = ::write(out_fd_, output_.data() + written, output_.size() - written);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                break;
+            }
+            written += static_cast<size_t>(n);
+#else
+            std::cout.write(output_.data(), static_cast<std::streamsize>(output_.size())).flush();
+            written = output_.size();
+#endif
+        }
+        output_.clear();
+    }
+
+private:
+    static constexpr size_t kInputBufferSize = 4096;
+
+    int in_fd_;
+    int out_fd_;
+    bool terminal_ = false;
+    Completer completer_;
+    // history
+    std::deque<std::string> history_;
+    size_t history_limit_ = 1000;
+    size_t history_index_ = 0;
+    std::string saved_line_;
+    // line being edited
+    std::string prompt_;
+    std::string buffer_;
+    size_t cursor_ = 0;     // byte index into buffer_
+    size_t offset_ = 0;     // byte index of the first visible character of buffer_
+    size_t width_ = 80;
+    // what is on the screen after the prompt
+    std::string rendered_;
+    size_t rendered_cursor_ = 0; // column after the prompt
+    // batched input and output
+    std::string input_;
+    size_t input_position_ = 0;
+    bool input_closed_ = false;
+    std::string output_;
+};
+
+/**
+ * @brief Interactive shell dispatching the commands typed by the user with a CLIDispatcher.
+ *
+ * The parser reads from the line editor on demand, so a command with an open `{` block continues on the
+ * next lines with the continuation prompt, and each command is dispatched as soon as it is complete.
+ * Parse and dispatch errors are printed to std::cerr and the shell continues with a new command.
+ * Command names are completed with Tab, Ctrl-C abandons the current command and Ctrl-D ends run().
+ *
+ * @code
+ * ArgCLITool::CLIDispatcher dispatcher;
+ * ArgCLITool::CLIRepl repl(dispatcher);
+ * dispatcher.add("exit", [&](const ArgCLITool::CommandArgs&) { repl.stop(); });
+ * repl.run();
+ * @endcode
+ */
+class CLIRepl {
+public:
+    explicit CLIRepl(const CLIDispatcher& dispatcher, int in_fd = 0, int out_fd = 1)
+        : dispatcher_(dispatcher), editor_(in_fd, out_fd), input_(*this) {
+        editor_.completer([this](std::string_view before, std::string_view) {
+            std::vector<std::string> candidates;
+            bool first_word = before.find_first_not_of(" \t") == std::string_view::npos;
+            if (first_word && !input_.pending()) {
+                candidates.assign(dispatcher_.commands().begin(), dispatcher_.commands().end());
+            }
+            return candidates;
+        });
+    }
+
+    // the completer and the input refer to this object
+    CLIRepl(const CLIRepl&) = delete;
+    CLIRepl& operator=(const CLIRepl&) = delete;
+
+    inline CLIRepl& prompt(std::string prompt) {
+        prompt_ = std::move(prompt);
+        return *this;
+    }
+
+    inline CLIRepl& continuationPrompt(std::string prompt) {
+        continuation_prompt_ = std::move(prompt);
+        return *this;
+    }
+
+    // line editor, to set the history limit or replace the completer
+    inline LineEditor& editor() {
+        return editor_;
+    }
+
+    // end run() after the current command, can be called from a command handler
+    inline void stop() {
+        stopped_ = true;
+    }
+
+    /**
+     * @brief Read, parse and dispatch commands until the end of the input or stop().
+     */
+    void run() {
+        stopped_ = false;
+        std::optional<CLIParser> parser;
+        parser.emplace(input_);
+        while (!stopped_) {
+            input_.beginCommand();
+            try {
+                if (!parser->hasMoreCommands()) {
+                    break;
+                }
+                Command command = parser->parseCommand();
+                if (!command.name.empty()) {
+                    dispatcher_.dispatch(std::move(command));
+                }
+                continue;
+            } catch (const Interrupted&) {
+                // abandon the command
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+            }
+            // start over on the next line, the parser may have looked ahead
+            input_.discardLine();
+            parser.emplace(input_);
+        }
+    }
+
+private:
+    // thrown by the input when Ctrl-C abandons the current command
+    struct Interrupted {};
+
+    // Input stream of the parser, reading the next line from the editor when the current line is consumed
+    class ReplInputStream : public CLIInputStream {
+    public:
+        explicit ReplInputStream(CLIRepl& repl) : repl_(repl) {}
+
+        char peek() override {
+            return fill() ? line_[position_] : static_cast<char>(std::char_traits<char>::eof());
+        }
+
+        bool get(char& c) override {
+            if (!fill()) {
+                return false;
+            }
+            c = line_[position_++];
+            ++offset_;
+            return true;
+        }
+
+        void unget() override {
+            if (position_ > 0) {
+                --position_;
+                --offset_;
+            }
+        }
+
+        int64_t tellg() override {
+            return offset_;
+        }
+
+        // the next line read starts a command, it is read with the primary prompt
+        inline void beginCommand() {
+            pending_ = false;
+        }
+
+        // true if the current command has text, so the next line is read with the continuation prompt
+        inline bool pending() const {
+            return pending_;
+        }
+
+        inline void discardLine() {
+            offset_ += static_cast<int64_t>(line_.size() - position_);
+            position_ = line_.size();
+        }
+
+    private:
+        // make sure there is a character to read, returns false at the end of the input
+        bool fill() {
+            while (position_ >= line_.size()) {
+                if (closed_) {
+                    return false;
+                }
+                const std::string& prompt = pending_ ? repl_.continuation_prompt_ : repl_.prompt_;
+                switch (repl_.editor_.readLine(prompt, line_)) {
+                    case LineEditor::ReadResult::Line:
+                        break;
+                    case LineEditor::ReadResult::Interrupted:
+                        line_.clear();
+                        position_ = 0;
+                        throw Interrupted{};
+                    case LineEditor::ReadResult::EndOfFile:
+                        line_.clear();
+                        position_ = 0;
+                        closed_ = true;
+                        return false;
+                }
+                repl_.editor_.addHistory(line_);
+                // blank and comment lines keep the primary prompt
+                size_t first = line_.find_first_not_of(" \t\r");
+                if (first != std::string::npos && line_[first] != '#') {
+                    pending_ = true;
+                }
+                line_ += '\n';
+                position_ = 0;
+            }
+            return true;
+        }
+
+    private:
+        CLIRepl& repl_;
+        std::string line_;
+        size_t position_ = 0;
+        int64_t offset_ = 0; // position in the whole session
+        bool pending_ = false;
+        bool closed_ = false;
+    };
+
+private:
+    const CLIDispatcher& dispatcher_;
+    LineEditor editor_;
+    ReplInputStream input_;
+    std::string prompt_ = "> ";
+    std::string continuation_prompt_ = "... ";
+    bool stopped_ = false;
+};
+
+}
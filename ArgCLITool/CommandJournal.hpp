@@ -0,0 +1,573 @@
+#pragma once
+
+#include "CLICommand.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ArgCLITool {
+
+namespace detail {
+
+/**
+ * @brief Byte oriented LZ77 codec in the style of LZ4, fast to decode and with no dependency.
+ *
+ * A block is a list of sequences, each one is literals followed by a match copied from earlier output:
+ *     token:u8 (literal length:4 bits, match length - 4:4 bits) [length:255...] literals
+ *     offset:u16 little endian [length:255...]
+ * A length field of 15 continues with bytes added to it until one is below 255. The last sequence has
+ * literals only. Matches are found with a single entry hash table over 4-byte windows, within 64 KiB.
+ */
+class LZCodec {
+public:
+    static void compress(std::string_view input, std::string& output) {
+        const char* in = input.data();
+        size_t size = input.size();
+        std::vector<uint32_t> table(kHashSize, 0); // position + 1 of the last window with the hash, 0 if none
+        size_t anchor = 0; // start of the pending literals
+        size_t i = 0;
+        while (size >= kMinMatch && i <= size - kMinMatch) {
+            uint32_t window = load32(in + i);
+            uint32_t& slot = table[hash(window)];
+            size_t candidate = slot;
+            slot = static_cast<uint32_t>(i + 1);
+            if (candidate == 0 || i - (candidate - 1) > kMaxOffset || load32(in + candidate - 1) != window) {
+                ++i;
+                continue;
+            }
+            size_t match = candidate - 1;
+            size_t length = kMinMatch;
+            while (i + length < size && in[match + length] == in[i + length]) {
+                ++length;
+            }
+            putSequence(output, input.substr(anchor, i - anchor), i - match, length);
+            i += length;
+            anchor = i;
+        }
+        putSequence(output, input.substr(anchor), 0, 0);
+    }
+
+    /**
+     * @brief Decompress input into output, which must be exactly size bytes.
+     *
+     * @throw std::invalid_argument if input is corrupted.
+     */
+    static void decompress(std::string_view input, std::string& output, size_t size) {
+        output.resize(size);
+        char* out = output.data();
+        size_t written = 0;
+        size_t i = 0;
+        while (i < input.size()) {
+            uint8_t token = static_cast<uint8_t>(input[i++]);
+            size_t literals = getLength(input, i, token >> 4);
+            if (literals > input.size() - i || literals > size - written) {
+                throw std::invalid_argument("Invalid compressed block");
+            }
+            std::memcpy(out + written, input.data() + i, literals);
+            i += literals;
+            written += literals;
+            if (i == input.size()) { // the last sequence has no match
+                break;
+            }
+            if (input.size() - i < 2) {
+                throw std::invalid_argument("Invalid compressed block");
+            }
+            size_t offset = static_cast<uint8_t>(input[i]) | (static_cast<size_t>(static_cast<uint8_t>(input[i + 1])) << 8);
+            i += 2;
+            size_t length = getLength(input, i, token & 0x0F) + kMinMatch;
+            if (offset == 0 || offset > written || length > size - written) {
+                throw std::invalid_argument("Invalid compressed block");
+            }
+            const char* from = out + written - offset;
+            if (offset >= length) {
+                std::memcpy(out + written, from, length);
+            } else { // overlapping match repeats the last offset bytes
+                for (size_t k = 0; k < length; ++k) {
+                    out[written + k] = from[k];
+                }
+            }
+            written += length;
+        }
+        if (written != size) {
+            throw std::invalid_argument("Invalid compressed block");
+        }
+    }
+
+private:
+    static constexpr size_t kMinMatch = 4;
+    static constexpr size_t kMaxOffset = 65535;
+    static constexpr int kHashBits = 14;
+    static constexpr size_t kHashSize = size_t(1) << kHashBits;
+
+    static inline uint32_t load32(const char* data) {
+        uint32_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    static inline uint32_t hash(uint32_t window) {
+        return (window * 2654435761u) >> (32 - kHashBits);
+    }
+
+    static void putLength(std::string& output, size_t length) {
+        for (; length >= 255; length -= 255) {
+            output += static_cast<char>(255);
+        }
+        output += static_cast<char>(length);
+    }
+
+    static size_t getLength(std::string_view input, size_t& i, size_t length) {
+        if (length != 15) {
+            return length;
+        }
+        uint8_t byte;
+        do {
+            if (i >= input.size()) {
+                throw std::invalid_argument("Invalid compressed block");
+            }
+            byte = static_cast<uint8_t>(input[i++]);
+            length += byte;
+        } while (byte == 255);
+        return length;
+    }
+
+    // literals, then a match of length at offset back, length 0 for the last sequence
+    static void putSequence(std::string& output, std::string_view literals, size_t offset, size_t length) {
+        size_t match = length == 0 ? 0 : length - kMinMatch;
+        output += static_cast<char>((std::min<size_t>(literals.size(), 15) << 4) | std::min<size_t>(match, 15));
+        if (literals.size() >= 15) {
+            putLength(output, literals.size() - 15);
+        }
+        output += literals;
+        if (length == 0) {
+            return;
+        }
+        output += static_cast<char>(offset & 0xFF);
+        output += static_cast<char>(offset >> 8);
+        if (match >= 15) {
+            putLength(output, match - 15);
+        }
+    }
+};
+
+}
+
+/*
+Journal format (byte order independent):
+    header: magic[4] version:u8
+            a header may be repeated between blocks, so journals can be concatenated, see CommandJournalWriter
+    block:  raw_size:varint stored_size:varint method:u8 payload[stored_size]
+            method 0 stores the records, method 1 stores them compressed with detail::LZCodec
+    record: name:string nargs:varint argument[nargs]
+    argument: type:u8 (Argument::Type) followed by
+        Identifier, String: string
+        Integer: zigzag varint
+        Float: u64 little endian, the bits of the double
+        IntegerVector: count:varint zigzag varint[count]
+        FloatVector: count:varint u64[count]
+    string: length:varint bytes[length]
+*/
+namespace detail {
+
+inline constexpr char kJournalMagic[4] = {'A', 'C', 'L', 'J'};
+inline constexpr uint8_t kJournalVersion = 1;
+
+}
+
+/**
+ * @brief Appends commands to a binary journal, in blocks that are optionally compressed.
+ *
+ * The header is written only when the stream is at its start, so an existing journal opened with std::ios::app
+ * is continued. A stream that cannot tell its position gets a header, the reader skips it between blocks.
+ *
+ * @code
+ * std::ofstream file("commands.journal", std::ios::binary | std::ios::app);
+ * ArgCLITool::CommandJournalWriter journal(file);
+ * dispatcher.onDispatch([&](const ArgCLITool::Command& command) { journal.append(command); });
+ * @endcode
+ */
+class CommandJournalWriter {
+public:
+    explicit CommandJournalWriter(std::ostream& stream) : stream_(stream) {
+        if (stream_.tellp() > 0) { // appending to a journal
+            return;
+        }
+        stream_.clear(); // tellp() fails on streams without a position, e.g. pipes
+        stream_.write(detail::kJournalMagic, sizeof(detail::kJournalMagic));
+        stream_.put(static_cast<char>(detail::kJournalVersion));
+    }
+
+    ~CommandJournalWriter() {
+        try {
+            flush();
+        } catch (...) {
+            // the stream is not usable, nothing more can be written
+        }
+    }
+
+    CommandJournalWriter(const CommandJournalWriter&) = delete;
+    CommandJournalWriter& operator=(const CommandJournalWriter&) = delete;
+
+    /**
+     * @brief Compress the blocks, a block is stored as it is when compressing does not make it smaller.
+     */
+    inline CommandJournalWriter& compress(bool enable = true) {
+        compress_ = enable;
+        return *this;
+    }
+
+    /**
+     * @brief Size of the records after which a block is written, 0 writes every command at once.
+     *
+     * @note Commands of the block not yet written are lost if the process dies, call flush() to bound them.
+     */
+    inline CommandJournalWriter& blockSize(size_t size) {
+        block_size_ = size;
+        return *this;
+    }
+
+    void append(const Command& command) {
+        putString(command.name);
+        putVarint(command.arguments.size());
+        for (const auto& argument : command.arguments) {
+            block_ += static_cast<char>(argument.type);
+            switch (argument.type) {
+                case Argument::Type::Identifier:
+                case Argument::Type::String:
+                    putString(std::get<StringData>(argument.data).value);
+                    break;
+                case Argument::Type::Integer:
+                    putInteger(std::get<IntegerData>(argument.data).value);
+                    break;
+                case Argument::Type::Float:
+                    putFloat(std::get<FloatData>(argument.data).value);
+                    break;
+                case Argument::Type::IntegerVector: {
+                    const auto& values = std::get<IntegerVectorData>(argument.data).value;
+                    putVarint(values.size());
+                    for (int64_t value : values) {
+                        putInteger(value);
+                    }
+                    break;
+                }
+                case Argument::Type::FloatVector: {
+                    const auto& values = std::get<FloatVectorData>(argument.data).value;
+                    putVarint(values.size());
+                    for (double value : values) {
+                        putFloat(value);
+                    }
+                    break;
+                }
+            }
+        }
+        if (block_.size() >= block_size_) {
+            flush();
+        }
+    }
+
+    // write the pending commands as a block and flush the stream
+    void flush() {
+        if (block_.empty()) {
+            return;
+        }
+        std::string_view payload = block_;
+        uint8_t method = 0;
+        if (compress_) {
+            compressed_.clear();
+            detail::LZCodec::compress(block_, compressed_);
+            if (compressed_.size() < block_.size()) {
+                payload = compressed_;
+                method = 1;
+            }
+        }
+        header_.clear();
+        putVarint(header_, block_.size());
+        putVarint(header_, payload.size());
+        header_ += static_cast<char>(method);
+        stream_.write(header_.data(), static_cast<std::streamsize>(header_.size()));
+        stream_.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+        stream_.flush();
+        block_.clear();
+        if (!stream_) {
+            throw std::runtime_error("Cannot write command journal");
+        }
+    }
+
+private:
+    static void putVarint(std::string& out, uint64_t value) {
+        while (value >= 0x80) {
+            out += static_cast<char>((value & 0x7F) | 0x80);
+            value >>= 7;
+        }
+        out += static_cast<char>(value);
+    }
+
+    inline void putVarint(uint64_t value) {
+        putVarint(block_, value);
+    }
+
+    inline void putInteger(int64_t value) { // zigzag, small negative values stay short
+        putVarint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+
+    void putFloat(double value) {
+        uint64_t bits = std::bit_cast<uint64_t>(value);
+        for (int i = 0; i < 8; ++i) {
+            block_ += static_cast<char>(bits >> (8 * i));
+        }
+    }
+
+    inline void putString(std::string_view text) {
+        putVarint(text.size());
+        block_ += text;
+    }
+
+private:
+    std::ostream& stream_;
+    bool compress_ = true;
+    size_t block_size_ = 64 * 1024;
+    std::string block_;      // records of the block being filled
+    std::string compressed_; // reused compression buffer
+    std::string header_;
+};
+
+/**
+ * @brief Reads the commands of a journal written by CommandJournalWriter, one block at a time.
+ */
+class CommandJournalReader {
+public:
+    /**
+     * @throw std::invalid_argument if stream is not a command journal.
+     */
+    explicit CommandJournalReader(std::istream& stream) : stream_(stream) {
+        readHeader();
+    }
+
+    /**
+     * @brief Read the next command into command, reusing its storage.
+     *
+     * @return bool False at the end of the journal.
+     * @throw std::invalid_argument if the journal is truncated or corrupted, after the commands before it are read.
+     */
+    bool next(Command& command) {
+        if (position_ == block_.size() && !readBlock()) {
+            return false;
+        }
+        getString(command.name);
+        uint64_t nargs = getVarint();
+        if (nargs > block_.size() - position_) { // every argument takes at least one byte
+            throw invalid();
+        }
+        command.arguments.resize(nargs);
+        for (auto& argument : command.arguments) {
+            uint8_t type = getByte();
+            if (type > static_cast<uint8_t>(Argument::Type::FloatVector)) {
+                throw invalid();
+            }
+            argument.type = static_cast<Argument::Type>(type);
+            switch (argument.type) {
+                case Argument::Type::Identifier:
+                case Argument::Type::String:
+                    getString(emplace<StringData>(argument).value);
+                    break;
+                case Argument::Type::Integer:
+                    emplace<IntegerData>(argument).value = getInteger();
+                    break;
+                case Argument::Type::Float:
+                    emplace<FloatData>(argument).value = getFloat();
+                    break;
+                case Argument::Type::IntegerVector: {
+                    auto& values = emplace<IntegerVectorData>(argument).value;
+                    uint64_t count = getVarint();
+                    if (count > block_.size() - position_) {
+                        throw invalid();
+                    }
+                    values.resize(count);
+                    for (auto& value : values) {
+                        value = getInteger();
+                    }
+                    break;
+                }
+                case Argument::Type::FloatVector: {
+                    auto& values = emplace<FloatVectorData>(argument).value;
+                    uint64_t count = getVarint();
+                    if (count > (block_.size() - position_) / 8) {
+                        throw invalid();
+                    }
+                    values.resize(count);
+                    for (auto& value : values) {
+                        value = getFloat();
+                    }
+                    break;
+                }
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Dispatch the remaining commands of the journal in order.
+     *
+     * @return size_t Number of commands dispatched.
+     */
+    size_t replay(const CLIDispatcher& dispatcher) {
+        size_t count = 0;
+        Command command;
+        while (next(command)) {
+            dispatcher.dispatch(std::move(command));
+            ++count;
+        }
+        return count;
+    }
+
+private:
+    static std::invalid_argument invalid() {
+        return std::invalid_argument("Invalid command journal");
+    }
+
+    // reuse the alternative of argument when it is already T
+    template <typename T>
+    static T& emplace(Argument& argument) {
+        if (T* data = std::get_if<T>(&argument.data)) {
+            return *data;
+        }
+        return argument.data.template emplace<T>();
+    }
+
+    void readHeader() {
+        char magic[sizeof(detail::kJournalMagic)];
+        if (!stream_.read(magic, sizeof(magic)) || std::memcmp(magic, detail::kJournalMagic, sizeof(magic)) != 0) {
+            throw invalid();
+        }
+        readVersion();
+    }
+
+    void readVersion() {
+        int version = stream_.get();
+        if (version != detail::kJournalVersion) {
+            throw std::invalid_argument("Unsupported command journal version: " + std::to_string(version));
+        }
+    }
+
+    // read the next block into block_, false at the end of the stream
+    bool readBlock() {
+        if (stream_.peek() == std::char_traits<char>::eof()) {
+            return false;
+        }
+        uint64_t raw_size = streamVarint();
+        uint64_t stored_size = streamVarint();
+        int method = stream_.get();
+        // a repeated header, its first 3 bytes read as a block with method 'L', which no block has
+        if (raw_size == static_cast<uint8_t>(detail::kJournalMagic[0]) &&
+            stored_size == static_cast<uint8_t>(detail::kJournalMagic[1]) && method == detail::kJournalMagic[2]) {
+            if (stream_.get() != detail::kJournalMagic[3]) {
+                throw invalid();
+            }
+            readVersion();
+            return readBlock();
+        }
+        if (method != 0 && method != 1) {
+            throw invalid();
+        }
+        std::string& target = method == 1 ? stored_ : block_;
+        // grow while reading, so a corrupted size does not allocate at once
+        target.clear();
+        while (target.size() < stored_size) {
+            size_t chunk = static_cast<size_t>(std::min<uint64_t>(stored_size - target.size(), kReadChunk));
+            size_t begin = target.size();
+            target.resize(begin + chunk);
+            if (!stream_.read(target.data() + begin, static_cast<std::streamsize>(chunk))) {
+                throw invalid();
+            }
+        }
+        if (method == 1) {
+            if (raw_size > stored_size * 255 + 16) { // beyond the ratio of the codec
+                throw invalid();
+            }
+            detail::LZCodec::decompress(stored_, block_, static_cast<size_t>(raw_size));
+        } else if (raw_size != stored_size) {
+            throw invalid();
+        }
+        position_ = 0;
+        return !block_.empty() || readBlock();
+    }
+
+    uint64_t streamVarint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            int byte = stream_.get();
+            if (byte == std::char_traits<char>::eof()) {
+                throw invalid();
+            }
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        throw invalid();
+    }
+
+    inline uint8_t getByte() {
+        if (position_ >= block_.size()) {
+            throw invalid();
+        }
+        return static_cast<uint8_t>(block_[position_++]);
+    }
+
+    uint64_t getVarint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t byte = getByte();
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        throw invalid();
+    }
+
+    inline int64_t getInteger() {
+        uint64_t value = getVarint();
+        return static_cast<int64_t>((value >> 1) ^ (0 - (value & 1)));
+    }
+
+    double getFloat() {
+        if (block_.size() - position_ < 8) {
+            throw invalid();
+        }
+        uint64_t bits = 0;
+        for (int i = 0; i < 8; ++i) {
+            bits |= static_cast<uint64_t>(static_cast<uint8_t>(block_[position_ + i])) << (8 * i);
+        }
+        position_ += 8;
+        return std::bit_cast<double>(bits);
+    }
+
+    void getString(std::string& text) {
+        uint64_t length = getVarint();
+        if (length > block_.size() - position_) {
+            throw invalid();
+        }
+        text.assign(block_.data() + position_, length);
+        position_ += length;
+    }
+
+private:
+    static constexpr size_t kReadChunk = 1 << 20;
+
+    std::istream& stream_;
+    std::string block_;  // records of the current block
+    std::string stored_; // compressed block
+    size_t position_ = 0;
+};
+
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ARGCLITOOL_HAS_MMAP 1
+#else
+#include <fstream>
+#include <iterator>
+#define ARGCLITOOL_HAS_MMAP 0
+#endif
+
+namespace ArgCLITool {
+
+// Read-only content of a whole file, memory mapped when the platform supports it
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+#if ARGCLITOOL_HAS_MMAP
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::invalid_argument("Cannot open file: " + path);
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::invalid_argument("Cannot stat file: " + path);
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ > 0) { // mapping an empty file fails
+            void* data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                ::close(fd);
+                throw std::invalid_argument("Cannot map file: " + path);
+            }
+            ::madvise(data, size_, MADV_SEQUENTIAL); // the content is read once from front to back
+            data_ = static_cast<const char*>(data);
+        }
+        ::close(fd); // the mapping stays valid after closing
+#else
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            throw std::invalid_argument("Cannot open file: " + path);
+        }
+        buffer_.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        data_ = buffer_.data();
+        size_ = buffer_.size();
+#endif
+    }
+
+    ~MappedFile() {
+#if ARGCLITOOL_HAS_MMAP
+        if (data_) {
+            ::munmap(const_cast<char*>(data_), size_);
+        }
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    inline std::string_view view() const {
+        return std::string_view(data_, size_);
+    }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+#if !ARGCLITOOL_HAS_MMAP
+    std::string buffer_;
+#endif
+};
+
+/**
+ * @brief Splits the content of a response file into arguments with shell-like quoting.
+ *
+ * @note Arguments are separated by whitespace. Inside single quotes every character is literal, inside double quotes
+ * @note a backslash escapes '"', '\', '$', '`' and the new line, outside quotes a backslash escapes any character.
+ * @note An escaped new line is removed.
+ */
+class ResponseFileTokenizer {
+public:
+    struct Token {
+        std::string_view raw; // source text of the argument, including quotes and escapes
+        bool plain;           // true if raw has no quotes or escapes, so raw is the argument itself
+    };
+
+public:
+    explicit ResponseFileTokenizer(std::string_view source) : source_(source), position_(0) {}
+
+    // Read the next argument, returns false at the end of the source
+    bool next(Token& token) {
+        while (position_ < source_.size() && isWhitespace(source_[position_])) {
+            ++position_;
+        }
+        if (position_ >= source_.size()) {
+            return false;
+        }
+        size_t begin = position_;
+        bool plain = true;
+        char quote = '\0'; // current quote character, '\0' if not quoted
+        for (; position_ < source_.size(); ++position_) {
+            char c = source_[position_];
+            if (quote == '\'') {
+                quote = c == '\'' ? '\0' : quote;
+            } else if (c == '\\') {
+                plain = false;
+                ++position_; // skip escaped character
+            } else if (quote == '"') {
+                quote = c == '"' ? '\0' : quote;
+            } else if (c == '\'' || c == '"') {
+                plain = false;
+                quote = c;
+            } else if (isWhitespace(c)) {
+                break;
+            }
+        }
+        if (quote != '\0') {
+            throw std::invalid_argument("Unterminated quote in response file");
+        }
+        position_ = std::min(position_, source_.size()); // a trailing backslash skips past the end
+        token = Token{source_.substr(begin, position_ - begin), plain};
+        return true;
+    }
+
+    /**
+     * @brief Remove the quotes and escapes of a raw argument.
+     *
+     * @param out Output buffer, at least raw.size() characters.
+     * @return size_t Length of the argument written to out.
+     */
+    static size_t unescape(std::string_view raw, char* out) {
+        size_t length = 0;
+        char quote = '\0';
+        for (size_t i = 0; i < raw.size(); ++i) {
+            char c = raw[i];
+            if (quote == '\'') {
+                if (c == '\'') {
+                    quote = '\0';
+                } else {
+                    out[length++] = c;
+                }
+            } else if (c == '\\' && i + 1 < raw.size()) {
+                char escaped = raw[++i];
+                if (escaped == '\n') {
+                    continue; // line continuation
+                }
+                if (quote == '"' && escaped != '"' && escaped != '\\' && escaped != '$' && escaped != '`') {
+                    out[length++] = c; // backslash is literal in double quotes
+                }
+                out[length++] = escaped;
+            } else if (c == '\\') {
+                continue; // trailing backslash
+            } else if (quote == '"') {
+                if (c == '"') {
+                    quote = '\0';
+                } else {
+                    out[length++] = c;
+                }
+            } else if (c == '\'' || c == '"') {
+                quote = c;
+            } else {
+                out[length++] = c;
+            }
+        }
+        return length;
+    }
+
+private:
+    static inline constexpr bool isWhitespace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+private:
+    std::string_view source_;
+    size_t position_;
+};
+
+}
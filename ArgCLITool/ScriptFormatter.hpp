@@ -0,0 +1,267 @@
+#pragma once
+
+#include "CLIParser.hpp"
+
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace ArgCLITool {
+
+/**
+ * @brief Rewrites scripts in the canonical layout, keeping their comments, in a single pass over the tokens.
+ *
+ * - one space between the command name and the arguments, a trailing comment follows after one space
+ * - vectors are written "[1, 2, 3]", whether they were bracketed, parenthesized or bare lists
+ * - a block starts with "{" at the end of its line and ends with "}" on its own line, aligned with the
+ *   command, the lines in between are indented
+ * - runs of blank lines become one, blank lines at the start and end of the script or of a block are dropped
+ *
+ * The output parses to the same commands as the input. Each token is formatted as it is read and the output
+ * is written in blocks, so memory does not grow with the script, only with its longest line.
+ *
+ * @code
+ * std::ifstream in("generated.cli");
+ * std::ofstream out("formatted.cli");
+ * ArgCLITool::ScriptFormatter(out).format(in);
+ * @endcode
+ */
+class ScriptFormatter {
+public:
+    explicit ScriptFormatter(std::ostream& out) : out_(out) {}
+
+    // spaces before the lines of a block, 4 by default
+    inline ScriptFormatter& indentWidth(size_t width) {
+        indent_ = std::string(width, ' ');
+        return *this;
+    }
+
+    /**
+     * @brief Format the script read from input.
+     *
+     * @throw CLIParseError on a syntax error, the output up to the error is written.
+     */
+    void format(CLIInputStream& input) {
+        try {
+            formatTokens(input);
+        } catch (...) {
+            flush(); // the lines before the error
+            throw;
+        }
+        flush();
+        out_.flush();
+    }
+
+    void format(std::istream& input) {
+        CLIStdInputStream stream(input);
+        format(stream);
+    }
+
+private:
+    static constexpr size_t kFlushSize = 64 * 1024; // output is written in blocks of about this size
+
+    struct State {
+        bool in_command = false;    // a command name was written and its arguments may follow
+        bool in_block = false;      // between "{" and "}"
+        bool line_open = false;     // the current output line has content
+        bool blank_allowed = false; // a blank line may follow, false at the start of the script and of a block
+        bool pending_blank = false; // a blank line is written before the next content
+    };
+
+    void formatTokens(CLIInputStream& input) {
+        CLIInputStreamHook hook(input);
+        CLILexer lexer(hook);
+        ErrorReporter reporter(hook);
+        State state;
+        while (true) {
+            CLIToken token = lexer.nextToken();
+            switch (token.type) {
+                case CLIToken::Type::Identifier:
+                    beginToken(state);
+                    buffer_ += token.value;
+                    state.in_command = true;
+                    break;
+                case CLIToken::Type::String:
+                case CLIToken::Type::Integer:
+                case CLIToken::Type::Float:
+                case CLIToken::Type::LeftParen:
+                case CLIToken::Type::LeftBracket:
+                    if (!state.in_command) {
+                        throw reporter.unexpectedTokenError(CLIToken::Type::Identifier, token);
+                    }
+                    beginToken(state);
+                    writeArgument(lexer, reporter, token);
+                    break;
+                case CLIToken::Type::LeftCurly:
+                    if (!state.in_command) {
+                        throw reporter.unexpectedTokenError(CLIToken::Type::Identifier, token);
+                    }
+                    if (state.in_block) {
+                        throw reporter.mismatchedTokenError(token);
+                    }
+                    beginToken(state);
+                    buffer_ += "{\n";
+                    state.in_block = true;
+                    state.line_open = false;
+                    state.blank_allowed = false;
+                    break;
+                case CLIToken::Type::RightCurly:
+                    if (!state.in_block) {
+                        throw reporter.mismatchedTokenError(token);
+                    }
+                    if (state.line_open) {
+                        buffer_ += '\n';
+                    }
+                    state.in_block = false;
+                    state.line_open = false;
+                    state.pending_blank = false;
+                    beginToken(state);
+                    buffer_ += '}';
+                    break;
+                case CLIToken::Type::Comment:
+                    beginToken(state);
+                    buffer_ += trimRight(token.value);
+                    break;
+                case CLIToken::Type::EndOfLine:
+                    if (state.line_open) {
+                        buffer_ += '\n';
+                        state.line_open = false;
+                        state.blank_allowed = true;
+                    } else if (state.blank_allowed) {
+                        state.pending_blank = true;
+                    }
+                    state.in_command = state.in_block;
+                    hook.clearConsumedTokens(); // the error report only needs the current line
+                    if (buffer_.size() >= kFlushSize) {
+                        flush();
+                    }
+                    break;
+                case CLIToken::Type::EndOfFile:
+                    if (state.in_block) {
+                        throw reporter.unexpectedTokenError(CLIToken::Type::RightCurly, token);
+                    }
+                    if (state.line_open) {
+                        buffer_ += '\n';
+                    }
+                    return;
+                case CLIToken::Type::RightParen:
+                case CLIToken::Type::RightBracket:
+                case CLIToken::Type::Comma:
+                    throw state.in_command ? reporter.unexpectedTokenError(token)
+                                           : reporter.unexpectedTokenError(CLIToken::Type::Identifier, token);
+                case CLIToken::Type::Unknown:
+                default:
+                    throw reporter.unknownTokenError(token);
+            }
+        }
+    }
+
+    void flush() {
+        out_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        buffer_.clear();
+    }
+
+    // start a line or separate the token from the previous one
+    void beginToken(State& state) {
+        if (state.line_open) {
+            buffer_ += ' ';
+            return;
+        }
+        if (state.pending_blank) {
+            buffer_ += '\n';
+            state.pending_blank = false;
+        }
+        if (state.in_block) {
+            buffer_ += indent_;
+        }
+        state.line_open = true;
+    }
+
+    // write the argument starting with token, a vector is read to its end
+    void writeArgument(CLILexer& lexer, ErrorReporter& reporter, const CLIToken& token) {
+        switch (token.type) {
+            case CLIToken::Type::String:
+                writeString(token.value);
+                return;
+            case CLIToken::Type::Integer:
+            case CLIToken::Type::Float:
+                if (lexer.peekToken().type != CLIToken::Type::Comma) {
+                    buffer_ += token.value;
+                    return;
+                }
+                buffer_ += '[';
+                buffer_ += token.value; // bare number list
+                for (size_t count = 1; lexer.peekToken().type == CLIToken::Type::Comma; ++count) {
+                    lexer.nextToken();
+                    buffer_ += ", ";
+                    buffer_ += readNumber(lexer, reporter);
+                    // CLIParser reads a number after a bare list of two numbers as a missing comma
+                    auto next = lexer.peekToken().type;
+                    if (count == 1 && (next == CLIToken::Type::Integer || next == CLIToken::Type::Float)) {
+                        throw reporter.unexpectedTokenError(CLIToken::Type::Comma, lexer.nextToken());
+                    }
+                }
+                buffer_ += ']';
+                return;
+            default: { // "(" or "["
+                auto closing = token.type == CLIToken::Type::LeftParen ? CLIToken::Type::RightParen
+                                                                      : CLIToken::Type::RightBracket;
+                buffer_ += '[';
+                buffer_ += readNumber(lexer, reporter);
+                while (true) {
+                    CLIToken next = lexer.nextToken();
+                    if (next.type == closing) {
+                        break;
+                    }
+                    if (next.type == CLIToken::Type::RightParen || next.type == CLIToken::Type::RightBracket) {
+                        throw reporter.mismatchedTokenError(next);
+                    }
+                    if (next.type != CLIToken::Type::Comma) {
+                        throw reporter.unexpectedTokenError(closing, next);
+                    }
+                    buffer_ += ", ";
+                    buffer_ += readNumber(lexer, reporter);
+                }
+                buffer_ += ']';
+                return;
+            }
+        }
+    }
+
+    static std::string readNumber(CLILexer& lexer, ErrorReporter& reporter) {
+        CLIToken token = lexer.nextToken();
+        if (token.type != CLIToken::Type::Integer && token.type != CLIToken::Type::Float) {
+            throw reporter.unexpectedTokenError("number", token);
+        }
+        return std::move(token.value);
+    }
+
+    // the lexer reads a backslash followed by any character as that character
+    void writeString(std::string_view value) {
+        buffer_ += '"';
+        size_t begin = 0;
+        for (size_t i = 0; i < value.size(); ++i) {
+            if (value[i] == '"' || value[i] == '\\') {
+                buffer_ += value.substr(begin, i - begin);
+                buffer_ += '\\';
+                begin = i;
+            }
+        }
+        buffer_ += value.substr(begin);
+        buffer_ += '"';
+    }
+
+    static std::string_view trimRight(std::string_view text) {
+        size_t end = text.find_last_not_of(" \t\r");
+        return text.substr(0, end == std::string_view::npos ? 0 : end + 1);
+    }
+
+private:
+    std::ostream& out_;
+    std::string indent_ = "    ";
+    std::string buffer_; // formatted lines not yet written to out_
+};
+
+}
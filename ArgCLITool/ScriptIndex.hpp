@@ -0,0 +1,271 @@
+#pragma once
+
+#include "CLIParser.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace ArgCLITool {
+
+// Command of a script with its source range
+struct ScriptCommand {
+    size_t begin = 0;  // start of the range, including the blank and comment lines before the command
+    size_t end = 0;    // after the new line ending the command
+    Command command;   // empty name if the command has a parse error
+    std::string error; // parse error message, empty if parsed
+    size_t error_begin = 0; // source range of the token of the error, if any
+    size_t error_end = 0;
+};
+
+// Commands replaced by ScriptIndex::update, the old commands [first, first + removed) are now [first, first + inserted)
+struct ScriptUpdate {
+    size_t first = 0;
+    size_t removed = 0;
+    size_t inserted = 0;
+
+    inline bool empty() const {
+        return removed == 0 && inserted == 0;
+    }
+};
+
+namespace detail {
+
+inline bool sameArgument(const Argument& a, const Argument& b) {
+    return a.type == b.type && std::visit([](const auto& x, const auto& y) {
+        if constexpr (std::is_same_v<decltype(x), decltype(y)>) {
+            return x.value == y.value;
+        } else {
+            return false;
+        }
+    }, a.data, b.data);
+}
+
+// same command and error, the source ranges are not compared
+inline bool sameCommand(const ScriptCommand& a, const ScriptCommand& b) {
+    return a.command.name == b.command.name && a.error == b.error &&
+           std::equal(a.command.arguments.begin(), a.command.arguments.end(),
+                      b.command.arguments.begin(), b.command.arguments.end(), sameArgument);
+}
+
+}
+
+/**
+ * @brief Commands of a script with their source ranges, updated incrementally when the script changes.
+ *
+ * The ranges partition the script from its first character to the end of the last command, so a range
+ * boundary is a position where the parser starts a command. After a change only the commands from the one
+ * reaching the changed text are parsed again, until a command ends past the change on an old boundary:
+ * from there the text and therefore the commands are the same as before, they are only moved.
+ *
+ * @note A command with a parse error ends at the end of the line of the error, parsing continues on the next line.
+ * @note An unterminated string or block makes the rest of the script one command, so an edit inside it parses
+ * @note the rest again until it is closed.
+ */
+class ScriptIndex {
+public:
+    ScriptIndex() = default;
+
+    explicit ScriptIndex(std::string source) : source_(std::move(source)) {
+        parseCommands(0, [this](ScriptCommand&& command) {
+            commands_.push_back(std::move(command));
+            return true;
+        });
+    }
+
+    inline const std::string& source() const {
+        return source_;
+    }
+
+    inline std::span<const ScriptCommand> commands() const {
+        return commands_;
+    }
+
+    // index of the command whose range contains offset, commands().size() if none
+    size_t find(size_t offset) const {
+        auto it = std::upper_bound(commands_.begin(), commands_.end(), offset,
+                                   [](size_t value, const ScriptCommand& command) { return value < command.end; });
+        return it != commands_.end() && it->begin <= offset ? static_cast<size_t>(it - commands_.begin()) : commands_.size();
+    }
+
+    // offset of the first token of the command at index, after the blank and comment lines of its range
+    size_t nameBegin(size_t index) const {
+        const ScriptCommand& command = commands_[index];
+        size_t position = command.begin;
+        while (position < command.end) {
+            char c = source_[position];
+            if (c == '#') {
+                size_t newline = source_.find('\n', position);
+                position = newline == std::string::npos ? command.end : newline + 1;
+            } else if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+                ++position;
+            } else {
+                break;
+            }
+        }
+        return std::min(position, command.end);
+    }
+
+    /**
+     * @brief Replace the script with source, parsing only the commands around the changed text.
+     *
+     * @return ScriptUpdate The commands that differ, commands only moved by the change are not included.
+     */
+    ScriptUpdate update(std::string source) {
+        std::string_view old_text = source_;
+        std::string_view new_text = source;
+        size_t limit = std::min(old_text.size(), new_text.size());
+        size_t prefix = static_cast<size_t>(
+            std::mismatch(old_text.begin(), old_text.begin() + limit, new_text.begin()).first - old_text.begin());
+        size_t suffix = 0;
+        while (suffix < limit - prefix && old_text[old_text.size() - 1 - suffix] == new_text[new_text.size() - 1 - suffix]) {
+            ++suffix;
+        }
+        size_t old_change_end = old_text.size() - suffix;
+        size_t new_change_end = new_text.size() - suffix;
+        source_ = std::move(source);
+        return reparse(prefix, old_change_end, new_change_end);
+    }
+
+    /**
+     * @brief Replace removed characters at offset with inserted, parsing only the commands around them.
+     *
+     * @note Same as update with the edited source, without comparing the whole source to find the change.
+     * @throw std::invalid_argument if the removed characters are not in the source.
+     */
+    ScriptUpdate edit(size_t offset, size_t removed, std::string_view inserted) {
+        if (offset > source_.size() || removed > source_.size() - offset) {
+            throw std::invalid_argument("Edit out of range: " + std::to_string(offset) + "+" + std::to_string(removed));
+        }
+        source_.replace(offset, removed, inserted);
+        return reparse(offset, offset + removed, offset + inserted.size());
+    }
+
+private:
+    /**
+     * @brief Parse source_ again after the text [change_begin, old_change_end) is replaced by [change_begin, new_change_end).
+     */
+    ScriptUpdate reparse(size_t change_begin, size_t old_change_end, size_t new_change_end) {
+        int64_t delta = static_cast<int64_t>(new_change_end) - static_cast<int64_t>(old_change_end);
+        // the first command reaching the change, a command ending at the change can be extended by it
+        size_t first = static_cast<size_t>(std::lower_bound(commands_.begin(), commands_.end(), change_begin,
+            [](const ScriptCommand& command, size_t value) { return command.end < value; }) - commands_.begin());
+        size_t start = first < commands_.size() ? commands_[first].begin : commands_.empty() ? 0 : commands_.back().end;
+        std::vector<ScriptCommand> parsed;
+        size_t last = first; // old commands [first, last) are replaced
+        bool synchronized = false;
+        parseCommands(start, [&](ScriptCommand&& command) {
+            size_t end = command.end;
+            parsed.push_back(std::move(command));
+            if (end < new_change_end) {
+                return true;
+            }
+            // past the change the text is the same as before, an old boundary here starts the same commands
+            size_t old_end = static_cast<size_t>(static_cast<int64_t>(end) - delta);
+            while (last < commands_.size() && commands_[last].end < old_end) {
+                ++last;
+            }
+            synchronized = last < commands_.size() && commands_[last].end == old_end;
+            if (synchronized) {
+                ++last;
+            }
+            return !synchronized;
+        });
+        if (!synchronized) {
+            last = commands_.size();
+        }
+        // report only the commands that differ, the same commands at both ends of the parsed ones are not changes
+        size_t removed = last - first;
+        size_t front = 0;
+        while (front < removed && front < parsed.size() && detail::sameCommand(commands_[first + front], parsed[front])) {
+            ++front;
+        }
+        size_t back = 0;
+        while (back < removed - front && back < parsed.size() - front &&
+               detail::sameCommand(commands_[last - 1 - back], parsed[parsed.size() - 1 - back])) {
+            ++back;
+        }
+        ScriptUpdate update{first + front, removed - front - back, parsed.size() - front - back};
+        // replace the old commands, in place where the counts match
+        size_t common = std::min(removed, parsed.size());
+        std::move(parsed.begin(), parsed.begin() + common, commands_.begin() + first);
+        if (parsed.size() > removed) {
+            commands_.insert(commands_.begin() + first + common, std::make_move_iterator(parsed.begin() + common),
+                             std::make_move_iterator(parsed.end()));
+        } else {
+            commands_.erase(commands_.begin() + first + common, commands_.begin() + last);
+        }
+        if (delta != 0) {
+            auto shift = [delta](size_t& position) {
+                position = static_cast<size_t>(static_cast<int64_t>(position) + delta);
+            };
+            for (size_t i = first + parsed.size(); i < commands_.size(); ++i) {
+                shift(commands_[i].begin);
+                shift(commands_[i].end);
+                if (!commands_[i].error.empty()) {
+                    shift(commands_[i].error_begin);
+                    shift(commands_[i].error_end);
+                }
+            }
+        }
+        return update;
+    }
+
+    /**
+     * @brief Parse the commands of source_ from the range boundary start, passing each one to callback.
+     *
+     * @note Stops at the end of the source, or when callback returns false.
+     */
+    template <typename Callback>
+    void parseCommands(size_t start, Callback&& callback) const {
+        std::string_view text = source_;
+        size_t begin = start;
+        while (begin < text.size()) {
+            // a parser per command, so that the command and its error only depend on the text from begin
+            CLIStringInputStream stream(text.substr(begin));
+            CLIParser parser(stream);
+            ScriptCommand command;
+            command.begin = begin;
+            try {
+                command.command = parser.parseCommand();
+                if (command.command.name.empty()) { // only blank and comment lines remain
+                    return;
+                }
+                command.end = begin + static_cast<size_t>(stream.tellg());
+            } catch (const std::exception& e) {
+                // skip to the end of the line of the error, unless the error is the new line
+                size_t position = begin + static_cast<size_t>(stream.tellg());
+                command.end = text.size();
+                if (position > begin && text[position - 1] == '\n') {
+                    command.end = position;
+                } else if (size_t newline = text.find('\n', position); newline != std::string_view::npos) {
+                    command.end = newline + 1;
+                }
+                command.command = Command{};
+                command.error = e.what();
+                command.error_begin = command.error_end = std::min(position, command.end);
+                if (const auto* parse_error = dynamic_cast<const CLIParseError*>(&e)) {
+                    command.error = parse_error->message(); // the range tells where
+                    command.error_begin = std::min(begin + static_cast<size_t>(parse_error->begin()), command.end);
+                    command.error_end = std::min(begin + static_cast<size_t>(parse_error->end()), command.end);
+                }
+            }
+            begin = command.end;
+            if (!callback(std::move(command))) {
+                return;
+            }
+        }
+    }
+
+private:
+    std::string source_;
+    std::vector<ScriptCommand> commands_;
+};
+
+}
@@ -0,0 +1,222 @@
+#pragma once
+
+#include "CLICommand.hpp"
+#include "ResponseFile.hpp"
+#include "ScriptIndex.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#define ARGCLITOOL_HAS_INOTIFY 1
+#else
+#include <filesystem>
+#include <thread>
+#define ARGCLITOOL_HAS_INOTIFY 0
+#endif
+
+namespace ArgCLITool {
+
+/**
+ * @brief Watches a script file and keeps its ScriptIndex up to date, parsing only the changed commands.
+ *
+ * @note On Linux the directory of the file is watched with inotify, for files written and closed or renamed
+ * @note over the file (how most editors save). Elsewhere the modification time is polled.
+ *
+ * @code
+ * ArgCLITool::ScriptWatcher watcher("config.cli");
+ * watcher.index().commands(); // commands of the current content
+ * watcher.run(dispatcher);    // dispatch the changed commands on every save
+ * @endcode
+ */
+class ScriptWatcher {
+public:
+    using Callback = std::function<bool(const ScriptIndex& index, const ScriptUpdate& update)>;
+
+public:
+    /**
+     * @throw std::invalid_argument if the file cannot be read, std::runtime_error if it cannot be watched.
+     */
+    explicit ScriptWatcher(std::string path) : path_(std::move(path)) {
+#if ARGCLITOOL_HAS_INOTIFY
+        size_t slash = path_.rfind('/');
+        std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path_.substr(0, slash);
+        name_ = slash == std::string::npos ? path_ : path_.substr(slash + 1);
+        fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd_ < 0 || ::inotify_add_watch(fd_, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+            if (fd_ >= 0) {
+                ::close(fd_);
+            }
+            throw std::runtime_error("Cannot watch file: " + path_);
+        }
+#else
+        modified_ = modificationTime();
+#endif
+        try {
+            index_ = ScriptIndex(readFile());
+        } catch (...) {
+#if ARGCLITOOL_HAS_INOTIFY
+            ::close(fd_);
+#endif
+            throw;
+        }
+    }
+
+    ~ScriptWatcher() {
+#if ARGCLITOOL_HAS_INOTIFY
+        ::close(fd_);
+#endif
+    }
+
+    ScriptWatcher(const ScriptWatcher&) = delete;
+    ScriptWatcher& operator=(const ScriptWatcher&) = delete;
+
+    inline const ScriptIndex& index() const {
+        return index_;
+    }
+
+    /**
+     * @brief Wait until the file changes, then update the index.
+     *
+     * @param timeout_ms Time to wait in milliseconds, -1 waits until the file changes.
+     * @return std::optional<ScriptUpdate> The changed commands, empty on timeout.
+     */
+    std::optional<ScriptUpdate> wait(int timeout_ms = -1) {
+        std::optional<Clock::time_point> deadline; // events of other files do not restart the timeout
+        if (timeout_ms >= 0) {
+            deadline = Clock::now() + std::chrono::milliseconds(timeout_ms);
+        }
+        while (waitChange(deadline)) {
+            std::string source;
+            try {
+                source = readFile();
+            } catch (const std::invalid_argument&) {
+                continue; // removed or replaced in the meantime, the next event brings the new file
+            }
+            return index_.update(std::move(source));
+        }
+        return std::nullopt;
+    }
+
+    /**
+     * @brief Call callback after every change of the file, until it returns false.
+     */
+    void run(const Callback& callback) {
+        while (true) {
+            if (auto update = wait(); update && !callback(index_, *update)) {
+                return;
+            }
+        }
+    }
+
+    /**
+     * @brief Dispatch the changed commands after every change of the file, does not return.
+     *
+     * @note Parse and dispatch errors are printed to std::cerr as "path:line: error", and the other commands are
+     * @note still dispatched.
+     */
+    void run(const CLIDispatcher& dispatcher) {
+        run([this, &dispatcher](const ScriptIndex& index, const ScriptUpdate& update) {
+            for (size_t i = update.first; i < update.first + update.inserted; ++i) {
+                const ScriptCommand& command = index.commands()[i];
+                if (!command.error.empty()) {
+                    std::cerr << path_ << ":" << lineNumber(command.error_begin) << ": " << command.error << std::endl;
+                    continue;
+                }
+                try {
+                    dispatcher.dispatch(command.command);
+                } catch (const std::exception& e) {
+                    std::cerr << path_ << ":" << lineNumber(index.nameBegin(i)) << ": " << e.what() << std::endl;
+                }
+            }
+            return true;
+        });
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    size_t lineNumber(size_t offset) const {
+        const std::string& source = index_.source();
+        return 1 + static_cast<size_t>(std::count(source.begin(), source.begin() + offset, '\n'));
+    }
+
+    std::string readFile() const {
+        MappedFile file(path_);
+        return std::string(file.view());
+    }
+
+#if ARGCLITOOL_HAS_INOTIFY
+    // wait for an event of the file, false once the deadline passes, no deadline waits forever
+    bool waitChange(const std::optional<Clock::time_point>& deadline) {
+        pollfd fd{fd_, POLLIN, 0};
+        while (true) {
+            int timeout_ms = -1;
+            if (deadline) {
+                auto remaining = std::chrono::ceil<std::chrono::milliseconds>(*deadline - Clock::now());
+                timeout_ms = static_cast<int>(std::max<std::chrono::milliseconds::rep>(remaining.count(), 0));
+            }
+            int ready = ::poll(&fd, 1, timeout_ms);
+            if (ready < 0 && errno == EINTR) {
+                continue;
+            }
+            if (ready <= 0) {
+                return false;
+            }
+            alignas(inotify_event) char buffer[4096];
+            bool changed = false;
+            ssize_t n;
+            while ((n = ::read(fd_, buffer, sizeof(buffer))) > 0) { // drain the events that arrived together
+                for (char* p = buffer; p < buffer + n;) {
+                    auto* event = reinterpret_cast<inotify_event*>(p);
+                    changed = changed || (event->len > 0 && name_ == event->name);
+                    p += sizeof(inotify_event) + event->len;
+                }
+            }
+            if (changed) {
+                return true;
+            }
+        }
+    }
+#else
+    std::filesystem::file_time_type modificationTime() const {
+        std::error_code error;
+        return std::filesystem::last_write_time(path_, error);
+    }
+
+    // poll the modification time, false once the deadline passes, no deadline waits forever
+    bool waitChange(const std::optional<Clock::time_point>& deadline) {
+        constexpr auto kInterval = std::chrono::milliseconds(100);
+        while (!deadline || Clock::now() < *deadline) {
+            if (auto modified = modificationTime(); modified != modified_) {
+                modified_ = modified;
+                return true;
+            }
+            std::this_thread::sleep_for(kInterval);
+        }
+        return false;
+    }
+#endif
+
+private:
+    std::string path_;
+    ScriptIndex index_;
+#if ARGCLITOOL_HAS_INOTIFY
+    std::string name_; // file name in the watched directory
+    int fd_ = -1;
+#else
+    std::filesystem::file_time_type modified_;
+#endif
+};
+
+}
@@ -0,0 +1,277 @@
+#pragma once
+
+#include "ArgParser.hpp"
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include <string_view>
+#include <stdexcept>
+
+namespace ArgCLITool {
+
+template <size_t N>
+class StaticArgParser;
+
+// Compile-time counterpart of ArgParser::add() and ArgParser::ArgumentSetter
+class ArgSpec {
+    template <size_t N>
+    friend class StaticArgParser;
+
+public:
+    constexpr ArgSpec(std::string_view name) {
+        // check empty
+        if (name.empty()) {
+            throw std::invalid_argument("Empty argument name");
+        }
+        if (detail::isPositional(name)) {
+            // the default number of values for positional argument is 1
+            entry_.position_name = name;
+            entry_.min_nvalues = 1;
+            entry_.max_nvalues = 1;
+        } else if (detail::isShortName(name)) {
+            entry_.short_name = name;
+        } else if (detail::isLongName(name)) {
+            entry_.long_name = name;
+        } else {
+            throw std::invalid_argument("Invalid argument name");
+        }
+    }
+
+    constexpr ArgSpec(std::string_view short_name, std::string_view long_name) {
+        // check empty
+        if (short_name.empty() || long_name.empty()) {
+            throw std::invalid_argument("Empty argument name");
+        }
+        // cannot be positional
+        if (detail::isPositional(short_name) || detail::isPositional(long_name)) {
+            throw std::invalid_argument("Positional argument cannot have multiple names");
+        }
+        // check name1 is short name and name2 is long name
+        if (!detail::isShortName(short_name) || !detail::isLongName(long_name)) {
+            throw std::invalid_argument("Invalid argument name");
+        }
+        entry_.short_name = short_name;
+        entry_.long_name = long_name;
+    }
+
+    constexpr ArgSpec& description(std::string_view description) {
+        entry_.description = description;
+        return *this;
+    }
+
+    constexpr ArgSpec& usage(std::string_view usage) {
+        entry_.usage = usage;
+        return *this;
+    }
+
+    /**
+     * @brief Set the number of values for the argument, same rules as ArgParser::ArgumentSetter::nvalues.
+     */
+    constexpr ArgSpec& nvalues(int min, int max = -1) {
+        detail::normalizeNValues(!entry_.position_name.empty(), min, max);
+        entry_.min_nvalues = min;
+        entry_.max_nvalues = max;
+        return *this;
+    }
+
+    /**
+     * @brief Set the default values for the argument.
+     *
+     * @note The values are not copied, default_values must have static storage duration.
+     */
+    constexpr ArgSpec& defaultValues(std::span<const std::string_view> default_values) {
+        entry_.default_values = default_values;
+        return *this;
+    }
+
+    /**
+     * @brief The argument must be given in the command line, see ArgParser::ArgumentSetter::required.
+     */
+    constexpr ArgSpec& required(bool required = true) {
+        required_ = required;
+        return *this;
+    }
+
+private:
+    detail::ArgEntry entry_;
+    bool required_ = false;
+};
+
+/**
+ * @brief ArgParser whose specification is validated and compiled at compile time.
+ *
+ * Name validation, duplicate checking and the name lookup table are computed during constant evaluation,
+ * so an invalid specification is a compile error and parse() only scans argv.
+ *
+ * @code
+ * constexpr std::string_view kJobs[] = {"4"};
+ * constexpr ArgCLITool::StaticArgParser kParser{
+ *     ArgCLITool::ArgSpec("input"),
+ *     ArgCLITool::ArgSpec("-j", "--jobs").nvalues(1).defaultValues(kJobs),
+ *     ArgCLITool::ArgSpec("-v", "--verbose"),
+ * };
+ * ArgCLITool::Args args = kParser.parse(argc, argv);
+ * @endcode
+ */
+template <size_t N>
+class StaticArgParser {
+public:
+    template <typename... Specs>
+    consteval StaticArgParser(const Specs&... specs) : entries_{specs.entry_...} {
+        size_t spec_index = 0;
+        ((specs.required_ ? detail::setBit(required_, spec_index++) : void(++spec_index)), ...);
+        for (size_t index = 0; index < N; ++index) {
+            const auto& arg = entries_[index];
+            if (!arg.position_name.empty()) {
+                positionals_[npositionals_++] = static_cast<int>(index);
+            }
+            for (std::string_view name : {arg.position_name, arg.short_name, arg.long_name}) {
+                // check duplicate
+                if (!name.empty() && !detail::insertName(slots_, name, static_cast<int>(index))) {
+                    throw std::invalid_argument("Duplicate argument name");
+                }
+            }
+        }
+        nlong_names_ = detail::sortLongNames(table().entries, long_names_);
+    }
+
+    /**
+     * @brief Add the `-h, --help` option, parse() then throws HelpRequested with the help message.
+     *
+     * @note Only the names not taken by other arguments are used.
+     */
+    constexpr StaticArgParser addHelp() const {
+        StaticArgParser parser = *this;
+        bool help_short_name = table().find("-h") == -1;
+        bool help_long_name = table().find("--help") == -1;
+        if (help_index_ == -1 && (help_short_name || help_long_name)) {
+            parser.entries_[N] = detail::helpEntry(help_short_name, help_long_name);
+            for (std::string_view name : {parser.entries_[N].short_name, parser.entries_[N].long_name}) {
+                if (!name.empty()) {
+                    detail::insertName(parser.slots_, name, static_cast<int>(N));
+                }
+            }
+            parser.help_index_ = static_cast<int>(N);
+            parser.nlong_names_ = detail::sortLongNames(parser.table().entries, parser.long_names_);
+        }
+        return parser;
+    }
+
+    constexpr StaticArgParser prog(std::string_view program_name) const {
+        StaticArgParser parser = *this;
+        parser.program_name_ = program_name;
+        return parser;
+    }
+
+    constexpr StaticArgParser usage(std::string_view usage) const {
+        StaticArgParser parser = *this;
+        parser.usage_ = usage;
+        return parser;
+    }
+
+    constexpr StaticArgParser description(std::string_view description) const {
+        StaticArgParser parser = *this;
+        parser.description_ = description;
+        return parser;
+    }
+
+    constexpr StaticArgParser epilog(std::string_view epilog) const {
+        StaticArgParser parser = *this;
+        parser.epilog_ = epilog;
+        return parser;
+    }
+
+    /**
+     * @brief Store parsed values as views into argv instead of copying them, see ArgParser::zeroCopy.
+     */
+    constexpr StaticArgParser zeroCopy(bool enable = true) const {
+        StaticArgParser parser = *this;
+        parser.scan_options_.zero_copy = enable;
+        return parser;
+    }
+
+    /**
+     * @brief Expand `@path` arguments to the arguments read from the file at path, see ArgParser::responseFiles.
+     */
+    constexpr StaticArgParser responseFiles(bool enable = true) const {
+        StaticArgParser parser = *this;
+        parser.scan_options_.response_files = enable;
+        return parser;
+    }
+
+    /**
+     * @brief Accept unambiguous prefixes of long names, see ArgParser::allowAbbrev.
+     */
+    constexpr StaticArgParser allowAbbrev(bool enable = true) const {
+        StaticArgParser parser = *this;
+        parser.scan_options_.allow_abbrev = enable;
+        return parser;
+    }
+
+    /**
+     * @brief Print the help message and exit the process when parse() sees the help option, see ArgParser::exitOnHelp.
+     */
+    constexpr StaticArgParser exitOnHelp(bool enable = true) const {
+        StaticArgParser parser = *this;
+        parser.scan_options_.exit_on_help = enable;
+        return parser;
+    }
+
+    /**
+     * @brief Parse argv.
+     *
+     * @note The program name in the help message is argv[0] unless set with prog().
+     * @throw HelpRequested if the help option is given, unless exitOnHelp() is set.
+     */
+    Args parse(int argc, char* argv[]) const {
+        return detail::ArgScanner::parse(table(), argc, argv, scan_options_);
+    }
+
+    /**
+     * @brief Help message, rendered once per terminal width and cached, the help option throws the same message.
+     */
+    std::string help() const {
+        return *detail::renderHelp(table());
+    }
+
+private:
+    constexpr detail::ArgTable table() const {
+        size_t nentries = help_index_ == -1 ? N : N + 1;
+        return detail::ArgTable{
+            .entries = std::span<const detail::ArgEntry>(entries_.data(), nentries),
+            .slots = slots_,
+            .long_names = std::span<const detail::NameSlot>(long_names_.data(), nlong_names_),
+            .positionals = std::span<const int>(positionals_.data(), npositionals_),
+            .commands = nullptr,
+            .command_list = {},
+            .prog = program_name_,
+            .usage = usage_,
+            .description = description_,
+            .epilog = epilog_,
+            .help_index = help_index_,
+            .help_cache = nullptr, // a compile-time parser cannot own the cache, see detail::sharedHelpCache
+            .constraints = detail::ArgConstraints{.required = required_},
+        };
+    }
+
+private:
+    std::array<detail::ArgEntry, N + 1> entries_; // the last entry is the help option, see addHelp
+    std::array<detail::NameSlot, detail::nameTableSize(2 * N + 2)> slots_{};
+    std::array<detail::NameSlot, N + 1> long_names_{}; // sorted, see detail::sortLongNames
+    size_t nlong_names_ = 0;
+    std::array<int, N> positionals_{};
+    size_t npositionals_ = 0;
+    int help_index_ = -1;
+    std::array<uint64_t, detail::bitsetWords(N + 1)> required_{};
+    std::string_view program_name_;
+    std::string_view usage_;
+    std::string_view description_;
+    std::string_view epilog_;
+    detail::ScanOptions scan_options_;
+};
+
+template <typename... Specs>
+StaticArgParser(const Specs&...) -> StaticArgParser<sizeof...(Specs)>;
+
+}
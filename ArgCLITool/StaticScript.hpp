@@ -0,0 +1,297 @@
+#pragma once
+
+#include "CLICommand.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace ArgCLITool {
+
+namespace detail {
+
+// Script source as a template argument, a string literal
+template <size_t N>
+struct ScriptLiteral {
+    char data[N]{};
+
+    consteval ScriptLiteral(const char (&source)[N]) {
+        std::copy_n(source, N, data);
+    }
+
+    constexpr std::string_view view() const {
+        return std::string_view(data, N - 1); // without the terminating null
+    }
+};
+
+// Parse every command of source, empty commands (blank and comment lines) are skipped
+constexpr std::vector<Command> parseScript(std::string_view source) {
+    CLIStringInputStream stream(source);
+    CLIParser parser(stream);
+    std::vector<Command> commands;
+    while (parser.hasMoreCommands()) {
+        Command command = parser.parseCommand();
+        if (!command.name.empty()) {
+            commands.push_back(std::move(command));
+        }
+    }
+    return commands;
+}
+
+// Storage needed by the commands of a script, see StaticScript
+struct ScriptSizes {
+    size_t commands = 0;
+    size_t arguments = 0;
+    size_t chars = 0;    // command names, identifiers and strings
+    size_t integers = 0; // elements of integer vectors
+    size_t floats = 0;   // elements of float vectors
+};
+
+constexpr ScriptSizes measureScript(std::string_view source) {
+    ScriptSizes sizes;
+    for (const auto& command : parseScript(source)) {
+        ++sizes.commands;
+        sizes.chars += command.name.size();
+        for (const auto& argument : command.arguments) {
+            ++sizes.arguments;
+            switch (argument.type) {
+                case Argument::Type::Identifier:
+                case Argument::Type::String:
+                    sizes.chars += std::get<StringData>(argument.data).value.size();
+                    break;
+                case Argument::Type::IntegerVector:
+                    sizes.integers += std::get<IntegerVectorData>(argument.data).value.size();
+                    break;
+                case Argument::Type::FloatVector:
+                    sizes.floats += std::get<FloatVectorData>(argument.data).value.size();
+                    break;
+                case Argument::Type::Integer:
+                case Argument::Type::Float:
+                    break;
+            }
+        }
+    }
+    return sizes;
+}
+
+// Float literals of compiled scripts have the bits the run-time parse gives, the compiler's own literals are
+// correctly rounded as well
+static_assert([] {
+    auto parsesTo = [](std::string_view text, double expected) {
+        double value = 0.0;
+        return parseFloat(text, value) && value == expected;
+    };
+    double unchanged = 0.0;
+    return parsesTo("0.1", 0.1) && parsesTo("1e300", 1e300) && parsesTo("1e-256", 1e-256) &&
+           parsesTo("1e200", 1e200) && parsesTo("-1e-200", -1e-200) && parsesTo("4.9e-324", 4.9e-324) &&
+           parsesTo("1.7976931348623157e308", 1.7976931348623157e308) &&
+           !parseFloat("1.7976931348623159e308", unchanged) && !parseFloat("2e-324", unchanged);
+}());
+
+}
+
+// Argument of a StaticScript command, the views point into the script
+struct StaticArgument {
+    Argument::Type type;
+    std::string_view text;          // Identifier, String
+    int64_t integer = 0;            // Integer
+    double floating = 0.0;          // Float
+    std::span<const int64_t> integers; // IntegerVector
+    std::span<const double> floats;    // FloatVector
+};
+
+/**
+ * @brief Commands of a script parsed at compile time, see compileScript.
+ *
+ * The commands are stored in fixed size arrays sized for the script, so the table can be a constexpr variable
+ * and reading it at run time involves no lexing or parsing.
+ */
+template <detail::ScriptSizes Sizes>
+class StaticScript {
+    template <detail::ScriptLiteral Source>
+    friend consteval auto compileScript();
+
+public:
+    constexpr size_t size() const {
+        return Sizes.commands;
+    }
+
+    constexpr std::string_view name(size_t index) const {
+        const auto& command = commands_[index];
+        return std::string_view(chars_.data() + command.name_begin, command.name_size);
+    }
+
+    constexpr size_t argumentCount(size_t index) const {
+        return commands_[index].argument_count;
+    }
+
+    constexpr StaticArgument argument(size_t index, size_t argument_index) const {
+        const auto& entry = arguments_[commands_[index].argument_begin + argument_index];
+        StaticArgument argument{.type = entry.type};
+        switch (entry.type) {
+            case Argument::Type::Identifier:
+            case Argument::Type::String:
+                argument.text = std::string_view(chars_.data() + entry.begin, entry.size);
+                break;
+            case Argument::Type::Integer:
+                argument.integer = entry.integer;
+                break;
+            case Argument::Type::Float:
+                argument.floating = entry.floating;
+                break;
+            case Argument::Type::IntegerVector:
+                argument.integers = std::span<const int64_t>(integers_.data() + entry.begin, entry.size);
+                break;
+            case Argument::Type::FloatVector:
+                argument.floats = std::span<const double>(floats_.data() + entry.begin, entry.size);
+                break;
+        }
+        return argument;
+    }
+
+    /**
+     * @brief The command at index, as produced by CLIParser.
+     */
+    constexpr Command command(size_t index) const {
+        Command command{.name = std::string(name(index)), .arguments = {}};
+        command.arguments.reserve(argumentCount(index));
+        for (size_t i = 0; i < argumentCount(index); ++i) {
+            StaticArgument view = argument(index, i);
+            Argument& arg = command.arguments.emplace_back(Argument{.type = view.type, .data = StringData()});
+            switch (view.type) {
+                case Argument::Type::Identifier:
+                case Argument::Type::String:
+                    arg.data = StringData(std::string(view.text));
+                    break;
+                case Argument::Type::Integer:
+                    arg.data = IntegerData(view.integer);
+                    break;
+                case Argument::Type::Float:
+                    arg.data = FloatData(view.floating);
+                    break;
+                case Argument::Type::IntegerVector:
+                    arg.data = IntegerVectorData(std::vector<int64_t>(view.integers.begin(), view.integers.end()));
+                    break;
+                case Argument::Type::FloatVector:
+                    arg.data = FloatVectorData(std::vector<double>(view.floats.begin(), view.floats.end()));
+                    break;
+            }
+        }
+        return command;
+    }
+
+    /**
+     * @brief Dispatch the commands in order, same as CLIDispatcher::run on the source but without parsing it.
+     */
+    void run(const CLIDispatcher& dispatcher) const {
+        for (size_t index = 0; index < size(); ++index) {
+            dispatcher.dispatch(command(index));
+        }
+    }
+
+private:
+    struct CommandEntry {
+        size_t name_begin = 0; // into chars_
+        size_t name_size = 0;
+        size_t argument_begin = 0; // into arguments_
+        size_t argument_count = 0;
+    };
+
+    struct ArgumentEntry {
+        Argument::Type type = Argument::Type::Identifier;
+        size_t begin = 0; // into chars_, integers_ or floats_ by type
+        size_t size = 0;
+        int64_t integer = 0;
+        double floating = 0.0;
+    };
+
+    constexpr void assign(const std::vector<Command>& commands) {
+        size_t nchars = 0;
+        size_t narguments = 0;
+        size_t nintegers = 0;
+        size_t nfloats = 0;
+        auto appendText = [&](std::string_view text) {
+            std::copy(text.begin(), text.end(), chars_.begin() + nchars);
+            nchars += text.size();
+        };
+        for (size_t index = 0; index < commands.size(); ++index) {
+            const auto& command = commands[index];
+            commands_[index] = CommandEntry{nchars, command.name.size(), narguments, command.arguments.size()};
+            appendText(command.name);
+            for (const auto& argument : command.arguments) {
+                ArgumentEntry& entry = arguments_[narguments++];
+                entry.type = argument.type;
+                switch (argument.type) {
+                    case Argument::Type::Identifier:
+                    case Argument::Type::String: {
+                        const auto& text = std::get<StringData>(argument.data).value;
+                        entry.begin = nchars;
+                        entry.size = text.size();
+                        appendText(text);
+                        break;
+                    }
+                    case Argument::Type::Integer:
+                        entry.integer = std::get<IntegerData>(argument.data).value;
+                        break;
+                    case Argument::Type::Float:
+                        entry.floating = std::get<FloatData>(argument.data).value;
+                        break;
+                    case Argument::Type::IntegerVector: {
+                        const auto& values = std::get<IntegerVectorData>(argument.data).value;
+                        entry.begin = nintegers;
+                        entry.size = values.size();
+                        std::copy(values.begin(), values.end(), integers_.begin() + nintegers);
+                        nintegers += values.size();
+                        break;
+                    }
+                    case Argument::Type::FloatVector: {
+                        const auto& values = std::get<FloatVectorData>(argument.data).value;
+                        entry.begin = nfloats;
+                        entry.size = values.size();
+                        std::copy(values.begin(), values.end(), floats_.begin() + nfloats);
+                        nfloats += values.size();
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    std::array<CommandEntry, Sizes.commands> commands_{};
+    std::array<ArgumentEntry, Sizes.arguments> arguments_{};
+    std::array<char, Sizes.chars> chars_{};
+    std::array<int64_t, Sizes.integers> integers_{};
+    std::array<double, Sizes.floats> floats_{};
+};
+
+/**
+ * @brief Parse the script Source at compile time into a StaticScript.
+ *
+ * A syntax error in the script is a compile error, reported at the parser's throw of the ErrorReporter error
+ * that describes it.
+ *
+ * @code
+ * constexpr auto kStartup = ArgCLITool::compileScript<R"(
+ * set verbose 1
+ * load {
+ *     "default.cfg"
+ *     "user.cfg"
+ * }
+ * )">();
+ * kStartup.run(dispatcher);
+ * @endcode
+ */
+template <detail::ScriptLiteral Source>
+consteval auto compileScript() {
+    constexpr detail::ScriptSizes sizes = detail::measureScript(Source.view());
+    StaticScript<sizes> script;
+    script.assign(detail::parseScript(Source.view()));
+    return script;
+}
+
+}
@@ -0,0 +1,108 @@
+// Parse time of ArgParser with 1000 declared options and up to 1M argv entries.
+//
+// The time per argv entry must stay flat as argv grows, the program fails if it more than doubles from 1/8 of
+// the entries to all of them. Build and run from the repository root, see README.md.
+
+#include "ArgCLITool/ArgParser.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int kOptions = 1000;
+constexpr size_t kEntries = 1'000'000;
+constexpr int kRuns = 3;
+
+// number of values of option i: flags, single values, pairs, and single values with a default
+int optionValues(int i) {
+    return i % 4 == 2 ? 2 : i % 4 == 0 ? 0 : 1;
+}
+
+void declareOptions(ArgCLITool::ArgParser& parser) {
+    for (int i = 0; i < kOptions; ++i) {
+        auto setter = parser.add("--option-" + std::to_string(i));
+        if (int n = optionValues(i); n > 0) {
+            setter.nvalues(n);
+        }
+        if (i % 4 == 3) {
+            setter.defaultValues({"default"});
+        }
+    }
+}
+
+// options in a pseudo random order, each followed by its values, until entries are written
+std::vector<std::string> makeArgv(size_t entries) {
+    std::vector<std::string> argv{"parse_bench"};
+    uint32_t state = 12345;
+    while (argv.size() < entries + 1) {
+        state = state * 1664525 + 1013904223;
+        int i = static_cast<int>((state >> 8) % kOptions);
+        if (argv.size() + optionValues(i) + 1 > entries + 1) {
+            i = 0; // a flag fills the remaining entry
+        }
+        argv.push_back("--option-" + std::to_string(i));
+        for (int v = 0; v < optionValues(i); ++v) {
+            argv.push_back("value-" + std::to_string(argv.size()));
+        }
+    }
+    return argv;
+}
+
+// entries shortened to end before an option, so that no option of the prefix is cut from its values
+size_t completeEntries(const std::vector<std::string>& argv, size_t entries) {
+    while (entries + 1 < argv.size() && argv[entries + 1][0] != '-') {
+        --entries;
+    }
+    return entries;
+}
+
+// best time of kRuns parses of the first entries of argv, in nanoseconds
+double parseTime(const ArgCLITool::FrozenArgParser& parser, std::vector<char*>& argv, size_t entries) {
+    double best = 0;
+    for (int run = 0; run < kRuns; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        ArgCLITool::Args args = parser.parse(static_cast<int>(entries + 1), argv.data());
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        if (args["--option-3"].as<std::string>().empty()) { // keeps the parse from being optimized out
+            std::puts("unexpected empty value");
+        }
+        best = run == 0 ? elapsed.count() : std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+}
+
+int main() {
+    ArgCLITool::ArgParser parser;
+    declareOptions(parser);
+    auto frozen = parser.freeze();
+    std::vector<std::string> storage = makeArgv(kEntries);
+    std::vector<char*> argv;
+    for (auto& entry : storage) {
+        argv.push_back(entry.data());
+    }
+    argv.push_back(nullptr);
+
+    std::printf("%d options\n%10s %10s %12s\n", kOptions, "entries", "ms", "ns/entry");
+    double first = 0;
+    double last = 0;
+    for (size_t entries = kEntries / 8; entries <= kEntries; entries *= 2) {
+        size_t prefix = completeEntries(storage, entries);
+        double time = parseTime(*frozen, argv, prefix);
+        double per_entry = time / static_cast<double>(prefix);
+        std::printf("%10zu %10.1f %12.1f\n", prefix, time / 1e6, per_entry);
+        first = first == 0 ? per_entry : first;
+        last = per_entry;
+    }
+    if (last > 2 * first) {
+        std::printf("not linear: %.1f ns/entry at %zu entries, %.1f at %zu\n", last, kEntries, first, kEntries / 8);
+        return 1;
+    }
+    return 0;
+}